@@ -0,0 +1,104 @@
+/*
+ * Throughput of the exponential ziggurat compared to the inversion.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/engine.hpp>
+#include <etascatgen/exponential.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using etascatgen::Xoshiro256pp;
+
+constexpr size_t BLOCK = 512;
+constexpr size_t REPEAT = 100000;
+
+
+/*
+ * Variates per second of fun(rng, E), which fills the BLOCK variates E:
+ */
+template<typename fun_t>
+static double throughput(fun_t&& fun, double& checksum)
+{
+    Xoshiro256pp rng(3319);
+    std::vector<double> E(BLOCK);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t r=0; r<REPEAT; ++r){
+        fun(rng, E.data());
+        checksum += E[r % BLOCK];
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return REPEAT * BLOCK
+           / std::chrono::duration<double>(stop - start).count();
+}
+
+
+int main()
+{
+    double checksum = 0.0;
+    std::vector<uint64_t> w(BLOCK);
+
+    /* One variate at a time, as in the event loops: */
+    const double scalar_inversion = throughput(
+        [](Xoshiro256pp& rng, double* E)
+        {
+            for (size_t k=0; k<BLOCK; ++k)
+                E[k] = -std::log(etascatgen::uniform_0_1(rng()));
+        },
+        checksum
+    );
+    const double scalar_ziggurat = throughput(
+        [](Xoshiro256pp& rng, double* E)
+        {
+            for (size_t k=0; k<BLOCK; ++k)
+                E[k] = etascatgen::exponential(rng);
+        },
+        checksum
+    );
+
+    /* Blocks of random words, as in the count sampler: */
+    const double block_inversion = throughput(
+        [&](Xoshiro256pp& rng, double* E)
+        {
+            rng.fill(w.data(), BLOCK);
+            for (size_t k=0; k<BLOCK; ++k)
+                E[k] = -std::log(etascatgen::uniform_0_1(w[k]));
+        },
+        checksum
+    );
+    const double block_ziggurat = throughput(
+        [&](Xoshiro256pp& rng, double* E)
+        {
+            rng.fill(w.data(), BLOCK);
+            etascatgen::exponential_block(w.data(), E, BLOCK, rng);
+        },
+        checksum
+    );
+
+    std::printf("%8s %16s %16s\n", "", "inversion [1/s]", "ziggurat [1/s]");
+    std::printf("%8s %16.4g %16.4g\n", "scalar", scalar_inversion,
+                scalar_ziggurat);
+    std::printf("%8s %16.4g %16.4g\n", "block", block_inversion,
+                block_ziggurat);
+    std::printf("(checksum %g)\n", checksum);
+    return 0;
+}
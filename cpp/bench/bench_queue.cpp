@@ -0,0 +1,142 @@
+/*
+ * Throughput of the priority queues of the sequential method.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/queue.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <vector>
+
+using etascatgen::Time;
+namespace bu = boost::units;
+
+
+/*
+ * A queue entry as in the sequential method (see descendant_t):
+ */
+struct entry_t {
+    Time tnext;
+    uint32_t parent;
+
+    bool operator<(const entry_t& other) const
+    {
+        return tnext > other.tnext;
+    }
+};
+
+
+/*
+ * The event load of the sequential method with Q active parents: Each
+ * event is taken from the top of the queue. Half of the time, its
+ * parent has a further descendant, which replaces the top entry.
+ * Otherwise, the parent is done, and the event itself becomes a parent
+ * whose first descendant is pushed. The delays follow the Omori law
+ * with p = 1.2, so that the queue holds times spread over many orders
+ * of magnitude. The delays and decisions are drawn beforehand, so that
+ * only the queue operations are timed.
+ */
+struct load_t {
+    std::vector<double> delay;
+    std::vector<bool> replace;
+};
+
+static load_t make_load(size_t n)
+{
+    constexpr double p = 1.2;
+    std::mt19937_64 rng(8732);
+    std::uniform_real_distribution<double> uniform;
+    load_t load;
+    load.delay.resize(n);
+    load.replace.resize(n);
+    for (size_t i=0; i<n; ++i){
+        load.delay[i] = std::pow(1.0 - uniform(rng), -1.0 / (p - 1.0)) - 1.0;
+        load.replace[i] = (uniform(rng) < 0.5);
+    }
+    return load;
+}
+
+
+/*
+ * Events per second of the queue, and a checksum of the event times:
+ */
+template<typename queue_t>
+static double throughput(const load_t& load, size_t Q, double& checksum)
+{
+    const size_t n = load.delay.size();
+    size_t d = 0;
+    auto next_delay = [&]() -> Time
+    {
+        const double x = load.delay[d];
+        d = (d + 1 < n) ? d + 1 : 0;
+        return x * bu::si::seconds;
+    };
+
+    queue_t queue;
+    for (uint32_t i=0; i<Q; ++i)
+        queue.push(entry_t(next_delay(), i));
+
+    checksum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t k=0; k<n; ++k){
+        entry_t e = queue.top();
+        const Time t = e.tnext;
+        checksum += t.value();
+        if (load.replace[k]){
+            e.tnext = t + next_delay();
+            etascatgen::replace_top(queue, e);
+        } else {
+            queue.pop();
+            queue.push(entry_t(t + next_delay(), static_cast<uint32_t>(k)));
+        }
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return n / std::chrono::duration<double>(stop - start).count();
+}
+
+
+int main()
+{
+    const load_t load = make_load(10000000);
+    std::printf("%10s %14s %14s %14s\n", "parents", "binary [1/s]",
+                "dary [1/s]", "radix [1/s]");
+    for (size_t Q : {1000, 100000, 1000000}){
+        double check[3];
+        const double binary = throughput<std::priority_queue<entry_t>>(
+            load, Q, check[0]
+        );
+        const double dary = throughput<etascatgen::DaryHeap<entry_t>>(
+            load, Q, check[1]
+        );
+        const double radix = throughput<etascatgen::RadixHeap<entry_t>>(
+            load, Q, check[2]
+        );
+        if (check[0] != check[1] || check[0] != check[2]){
+            std::printf("The queues yield different event sequences.\n");
+            return 1;
+        }
+        std::printf("%10zu %14.4g %14.4g %14.4g\n", Q, binary, dary, radix);
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Catalog output that grows in chunks of fixed size.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_ARENA_HPP
+#define ETASCATGEN_ARENA_HPP
+
+#include <cyantities/quantitywrap.hpp>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * An arena of occurrence times (in seconds) and magnitudes. Storage
+ * is allocated in chunks of `chunk_size` events that are never moved,
+ * so growing the catalog does not copy previously stored events.
+ * The chunks are allocated with std::malloc, and their ownership can
+ * be handed over (`release_t`, `release_M`) to be freed by std::free.
+ */
+class CatalogArena {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 16;
+
+    CatalogArena(size_t chunk_size = DEFAULT_CHUNK_SIZE)
+       : chunk_size(chunk_size), n_last(chunk_size)
+    {
+        if (chunk_size == 0)
+            throw std::runtime_error("The chunk size needs to be positive.");
+    }
+
+    CatalogArena(const CatalogArena&) = delete;
+    CatalogArena& operator=(const CatalogArena&) = delete;
+
+    ~CatalogArena()
+    {
+        for (chunk_t& chunk : chunks){
+            std::free(chunk.t);
+            std::free(chunk.M);
+        }
+    }
+
+    void push(double t, double M)
+    {
+        if (n_last == chunk_size)
+            new_chunk();
+        t_last[n_last] = t;
+        M_last[n_last] = M;
+        ++n_last;
+    }
+
+    /* Total number of events: */
+    size_t size() const
+    {
+        return chunks.empty() ? 0
+            : (chunks.size() - 1) * chunk_size + n_last;
+    }
+
+    size_t n_chunks() const
+    {
+        return chunks.size();
+    }
+
+    /* Number of events in chunk k: */
+    size_t chunk_length(size_t k) const
+    {
+        return (k+1 == chunks.size()) ? n_last : chunk_size;
+    }
+
+    /* Times and magnitudes of chunk k: */
+    const double* chunk_times(size_t k) const
+    {
+        return chunks.at(k).t;
+    }
+
+    const double* chunk_magnitudes(size_t k) const
+    {
+        return chunks.at(k).M;
+    }
+
+    /*
+     * Hand over the ownership of the times or magnitudes of chunk k.
+     * Afterwards, the arena no longer has access to them.
+     */
+    double* release_t(size_t k)
+    {
+        double* t = chunks.at(k).t;
+        chunks[k].t = nullptr;
+        return t;
+    }
+
+    double* release_M(size_t k)
+    {
+        double* M = chunks.at(k).M;
+        chunks[k].M = nullptr;
+        return M;
+    }
+
+    /*
+     * Copy the catalog to contiguous arrays of size `size()`:
+     */
+    void copy_to(
+        cyantities::QuantityWrapper& Mi,
+        cyantities::QuantityWrapper& ti
+    ) const;
+
+private:
+    struct chunk_t {
+        double* t;
+        double* M;
+    };
+
+    size_t chunk_size;
+    std::vector<chunk_t> chunks;
+    double* t_last = nullptr;
+    double* M_last = nullptr;
+    size_t n_last;
+
+    void new_chunk()
+    {
+        chunks.reserve(chunks.size() + 1);
+        t_last = static_cast<double*>(
+            std::malloc(chunk_size * sizeof(double))
+        );
+        M_last = static_cast<double*>(
+            std::malloc(chunk_size * sizeof(double))
+        );
+        chunks.push_back(chunk_t(t_last, M_last));
+        if (!t_last || !M_last)
+            throw std::bad_alloc();
+        n_last = 0;
+    }
+};
+
+
+/*
+ * The catalogs of an ensemble, one arena per member, so that the
+ * members can be generated concurrently. The catalogs are ragged and
+ * can be concatenated into offset-indexed (CSR) arrays, in which
+ * member k occupies the index range [offsets[k], offsets[k+1]).
+ */
+class CatalogEnsemble {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 12;
+
+    CatalogEnsemble(
+        size_t n_members,
+        size_t chunk_size = DEFAULT_CHUNK_SIZE
+    )
+    {
+        members.reserve(n_members);
+        for (size_t k=0; k<n_members; ++k)
+            members.push_back(std::make_unique<CatalogArena>(chunk_size));
+    }
+
+    size_t n_members() const
+    {
+        return members.size();
+    }
+
+    CatalogArena& member(size_t k)
+    {
+        return *members.at(k);
+    }
+
+    /* Total number of events: */
+    size_t size() const
+    {
+        size_t n = 0;
+        for (const std::unique_ptr<CatalogArena>& m : members)
+            n += m->size();
+        return n;
+    }
+
+    /* The n_members + 1 offsets of the members in the CSR arrays: */
+    std::vector<size_t> offsets() const
+    {
+        std::vector<size_t> off(members.size() + 1, 0);
+        for (size_t k=0; k<members.size(); ++k)
+            off[k+1] = off[k] + members[k]->size();
+        return off;
+    }
+
+    /*
+     * Copy the concatenated catalogs to contiguous arrays of size
+     * `size()`:
+     */
+    void copy_to(
+        cyantities::QuantityWrapper& Mi,
+        cyantities::QuantityWrapper& ti
+    ) const;
+
+private:
+    std::vector<std::unique_ptr<CatalogArena>> members;
+};
+
+}
+
+#endif
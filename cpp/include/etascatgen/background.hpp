@@ -0,0 +1,229 @@
+/*
+ * The background rate of the ETAS process.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_BACKGROUND_HPP
+#define ETASCATGEN_BACKGROUND_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * The background rate
+ *    mu(t) = mu_0 * m(t)
+ * where the forcing m(t) is either one or given by a table of factors
+ * m[k] at the knots T[k]. Between the knots, m(t) is piecewise
+ * constant (m(t) = m[k] on [T[k], T[k+1])) or piecewise linear. Before
+ * the first and after the last knot, m(t) continues with the value at
+ * that knot.
+ *
+ * The background events form a homogeneous Poisson process in the
+ * cumulative forcing
+ *    C(t) = int_T[0]^t m(t') dt',
+ * so that the next background event after tl follows by inverting C
+ * at C(tl) - log(q) / mu_0. C is tabulated at the knots, and the
+ * segment is found by a binary search for tl followed by a galloping
+ * search for the target, which is amortized O(1) if there are many
+ * background events per segment. Within a segment, C is inverted in
+ * closed form.
+ */
+class BackgroundRate {
+public:
+    /*
+     * Constant rate mu_0:
+     */
+    BackgroundRate(Frequency mu_0) : mu_0(mu_0), linear(false)
+    {}
+
+    BackgroundRate(
+        Frequency mu_0,
+        const std::vector<double>& T_s,
+        const std::vector<double>& factors,
+        bool linear
+    ) : mu_0(mu_0), linear(linear), m(factors)
+    {
+        const size_t K = T_s.size();
+        if (K == 0 || factors.size() != K)
+            throw std::runtime_error(
+                "The background table needs knots and factors of equal, "
+                "non-zero size."
+            );
+        for (size_t k=0; k<K; ++k){
+            if (!std::isfinite(T_s[k]) || (k > 0 && !(T_s[k] > T_s[k-1])))
+                throw std::runtime_error(
+                    "Knots of the background table need to be finite and "
+                    "strictly increasing."
+                );
+            if (!(m[k] >= 0.0) || !std::isfinite(m[k]))
+                throw std::runtime_error(
+                    "Factors of the background table need to be finite "
+                    "and non-negative."
+                );
+        }
+        if (!(m.back() > 0.0))
+            throw std::runtime_error(
+                "The last factor of the background table needs to be "
+                "positive."
+            );
+
+        /*
+         * Knots and cumulative forcing:
+         */
+        T.resize(K);
+        C.resize(K);
+        for (size_t k=0; k<K; ++k)
+            T[k] = T_s[k] * bu::si::seconds;
+        C[0] = 0.0 * bu::si::seconds;
+        for (size_t k=1; k<K; ++k){
+            const double m_k = linear ? 0.5 * (m[k-1] + m[k]) : m[k-1];
+            C[k] = C[k-1] + m_k * (T[k] - T[k-1]);
+        }
+    }
+
+    /*
+     * The next background event after tl, given a uniform q in (0,1].
+     */
+    Time next(double q, Time tl) const
+    {
+        if (T.empty())
+            return tl - std::log(q) / mu_0;
+
+        const Time Cq = cumulative(tl) - std::log(q) / mu_0;
+        return std::max(tl, inverse_cumulative(Cq, segment(tl)));
+    }
+
+    /*
+     * The n background events t[0..n) following tl, given n unit
+     * exponentials E. In the cumulative forcing, they are a prefix sum
+     * of E / mu_0:
+     */
+    void next(const double* E, size_t n, Time tl, Time* t) const
+    {
+        if (T.empty()){
+            const Time scale = 1.0 / mu_0;
+            for (size_t k=0; k<n; ++k){
+                tl += E[k] * scale;
+                t[k] = tl;
+            }
+            return;
+        }
+
+        Time Cq = cumulative(tl);
+        for (size_t k=0; k<n; ++k){
+            Cq += E[k] / mu_0;
+            tl = std::max(tl, inverse_cumulative(Cq, segment(tl)));
+            t[k] = tl;
+        }
+    }
+
+    /*
+     * The expected number of background events within [t0, t1]:
+     */
+    double expected(Time t0, Time t1) const
+    {
+        if (T.empty())
+            return mu_0 * (t1 - t0);
+        return mu_0 * (cumulative(t1) - cumulative(t0));
+    }
+
+private:
+    Frequency mu_0;
+    bool linear;
+    std::vector<Time> T;
+    std::vector<double> m;
+    std::vector<Time> C;
+
+    /* Slope of the forcing in segment k < K-1: */
+    Frequency slope(size_t k) const
+    {
+        return (m[k+1] - m[k]) / (T[k+1] - T[k]);
+    }
+
+    /*
+     * Index of the last knot at or before t (0 if t is before the
+     * first knot):
+     */
+    size_t segment(Time t) const
+    {
+        const size_t k = std::upper_bound(T.cbegin(), T.cend(), t)
+                         - T.cbegin();
+        return (k == 0) ? 0 : k-1;
+    }
+
+    Time cumulative(Time t) const
+    {
+        const size_t k = segment(t);
+        const Time dt = t - T[k];
+        if (dt < 0.0 * bu::si::seconds || k+1 == T.size() || !linear)
+            return C[k] + m[k] * dt;
+        return C[k] + dt * (m[k] + 0.5 * slope(k) * dt);
+    }
+
+    Time inverse_cumulative(Time Cq, size_t k0) const
+    {
+        /*
+         * Before the first knot:
+         */
+        if (Cq < C[0])
+            return T[0] + (Cq - C[0]) / m[0];
+
+        /*
+         * Galloping search for the last knot k with C[k] <= Cq,
+         * starting from the segment of the previous event:
+         */
+        const size_t K = T.size();
+        size_t lo = k0;
+        size_t hi = k0 + 1;
+        size_t step = 1;
+        while (hi < K && C[hi] <= Cq){
+            lo = hi;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, K);
+        const size_t k = std::upper_bound(
+            C.cbegin() + lo, C.cbegin() + hi, Cq
+        ) - C.cbegin() - 1;
+
+        /*
+         * Invert within the segment:
+         */
+        const Time r = Cq - C[k];
+        if (k+1 == K || !linear)
+            return T[k] + r / m[k];
+
+        /*
+         * Solve m[k] * dt + slope/2 * dt**2 = r in a form that is
+         * stable for both signs of the slope:
+         */
+        const double D = m[k] * m[k] + 2.0 * slope(k) * r;
+        const Time dt = 2.0 * r / (m[k] + std::sqrt(std::max(D, 0.0)));
+        return std::min(T[k] + dt, T[k+1]);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Catalog generation using the cluster representation of the
+ * Hawkes process.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_CLUSTER_HPP
+#define ETASCATGEN_CLUSTER_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <etascatgen/philox.hpp>
+#include <etascatgen/process.hpp>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Building blocks of the cluster method
+ * =====================================
+ */
+
+/*
+ * An event of the catalog:
+ */
+struct event_t {
+    Time t;
+    double M;
+};
+
+
+/*
+ * An event of a cluster generation, which additionally carries its
+ * productivity f(M) and its identity within the cluster (see below):
+ */
+struct parent_t {
+    Time t;
+    double M;
+    double f;
+    std::array<uint64_t,2> id = {0, 0};
+};
+
+
+/*
+ * Random numbers
+ * ==============
+ * All random numbers are derived from the Philox4x64-10 counter-based
+ * generator, keyed by (seed, cluster id) where the cluster id is the
+ * index of the background event that roots the cluster. Each event of
+ * the cluster has a 128 bit identity (a, b), and the counter (a, b, s, k)
+ * yields the k'th block of four random words of its stream s:
+ *    s = 0:  word 0:   waiting time since the previous background event
+ *                      (root only)
+ *            word 1:   magnitude (root only)
+ *            word 2..: number of its direct offspring
+ *    s = 1:  further random numbers of the event if required (rejection
+ *            sampling of its delay)
+ *    s = 2:  block l describes its l'th direct offspring:
+ *            words 0, 1: identity of the offspring
+ *            word 2:     delay of the offspring to the event
+ *            word 3:     magnitude of the offspring
+ * The root has the identity (0, 0). Since the identities of the
+ * offspring follow from their parent only, the catalog does not depend
+ * on the order in which the clusters are simulated, and the events of a
+ * cluster before t_end do not depend on t_end. Two events share their
+ * identity with a probability of order 2^-128.
+ */
+inline philox_key_t cluster_key(size_t seed, uint64_t cluster)
+{
+    return philox_key_t({seed, cluster});
+}
+
+/*
+ * The clusters of the synthetic history of the stationary
+ * initialization use the cluster ids with the highest bit set:
+ */
+inline philox_key_t history_key(size_t seed, uint64_t cluster)
+{
+    return philox_key_t({seed, cluster | (uint64_t(1) << 63)});
+}
+
+inline const Time INFINITE_TIME
+    = std::numeric_limits<double>::infinity() * bu::si::seconds;
+
+
+/*
+ * The delay of an offspring to its parent from the uniform u. Kernels
+ * that are sampled by thinning draw the delay by rejection from their
+ * envelope, using the stream s = 1 of the offspring `id`.
+ */
+template<typename kernel_t>
+Time draw_delay(
+    const kernel_t& kernel,
+    double u,
+    const philox_key_t& key,
+    const std::array<uint64_t,2>& id
+)
+{
+    Time delay = kernel.inverse_survival(u);
+    if constexpr (requires { kernel.acceptance(delay); }){
+        PhiloxStream stream(key, id[0], id[1], 1);
+        while (uniform_0_1(stream()) > kernel.acceptance(delay))
+            delay = kernel.inverse_survival(uniform_0_1(stream()));
+    }
+    return delay;
+}
+
+
+/*
+ * Simulate the cluster rooted in the background event `root` and
+ * append all its events (including the root) before t_end to
+ * `events`. The descendants of events at or after t_end are not
+ * simulated. `generation` and `offspring` are working buffers. If
+ * `events` holds parent_t, the events keep their productivity.
+ */
+template<typename kernel_t, typename magnitudes_t, typename out_t>
+void simulate_cluster(
+    const parent_t& root,
+    const philox_key_t& key,
+    const Process_M_t& process,
+    const kernel_t& kernel,
+    const magnitudes_t& magnitudes,
+    std::vector<out_t>& events,
+    std::vector<parent_t>& generation,
+    std::vector<parent_t>& offspring,
+    Time t_end
+)
+{
+    auto append = [&events](const parent_t& e)
+    {
+        if constexpr (std::is_same_v<out_t, parent_t>)
+            events.push_back(e);
+        else
+            events.emplace_back(e.t, e.M);
+    };
+    append(root);
+    generation.assign(1, root);
+    generation[0].id = {0, 0};
+    while (!generation.empty()){
+        offspring.clear();
+        for (const parent_t& parent : generation){
+            /*
+             * Total number of direct offspring of this event:
+             */
+            const double Lambda = expected_offspring(parent.f, process);
+            if (Lambda <= 0.0)
+                continue;
+            PhiloxStream stream(key, parent.id[0], parent.id[1], 0, 2);
+            std::poisson_distribution<size_t> poisson(Lambda);
+            const size_t k = poisson(stream);
+
+            /*
+             * Their identities, occurrence times, and magnitudes:
+             */
+            for (uint64_t l=0; l<k; ++l){
+                const philox_ctr_t u = philox4x64(
+                    {parent.id[0], parent.id[1], 2, l}, key
+                );
+                const std::array<uint64_t,2> id = {u[0], u[1]};
+                const Time t = parent.t + draw_delay(
+                    kernel, uniform_0_1(u[2]), key, id
+                );
+                if (t >= t_end)
+                    continue;
+                const magnitude_t m = magnitudes.draw(uniform_0_1(u[3]));
+                offspring.emplace_back(t, m.M, m.f, id);
+            }
+        }
+        for (const parent_t& e : offspring)
+            append(e);
+        std::swap(generation, offspring);
+    }
+}
+
+
+/*
+ * Generate the catalog from the Poisson cluster representation:
+ * Each background event roots a cluster of descendants that is
+ * independent of all other clusters. Within a cluster, each event
+ * has a Poisson-distributed number of direct offspring with mean
+ * given by its total expected offspring, and the offspring delays
+ * are i.i.d. following the (normalized) time kernel `options.kernel`.
+ * The clusters are simulated in parallel on `options.threads`
+ * threads.
+ * The events are passed to the sink (see sink.hpp).
+ * Instantiated for the magnitude distributions of magnitude.hpp and
+ * the sinks of sink.hpp.
+ */
+template<typename magnitudes_t, typename sink_t>
+void generate_cluster(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    sink_t& sink
+);
+
+/*
+ * A synthetic history of the process for the stationary initialization
+ * (see GenerationOptions): Simulates the clusters of the background
+ * events within [-options.init_window, 0) in parallel, discarding all
+ * events at or after t = 0, and returns the times and productivities
+ * of the events that are expected to have more than
+ * options.init_tolerance direct descendants after t = 0.
+ * Instantiated for the magnitude distributions of magnitude.hpp.
+ */
+template<typename magnitudes_t>
+void stationary_history(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    std::vector<Time>& t,
+    std::vector<double>& f
+);
+
+}
+
+#endif
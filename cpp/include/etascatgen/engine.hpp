@@ -0,0 +1,332 @@
+/*
+ * Random number engines and block conversion to uniforms.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_ENGINE_HPP
+#define ETASCATGEN_ENGINE_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/philox.hpp>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <variant>
+
+/*
+ * The block loops below are compiled for AVX-512, AVX2, and the
+ * baseline, and the best version is selected at load time. This
+ * requires GCC on an x86-64 ELF platform.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+    && defined(__ELF__)
+#define ETASCATGEN_SIMD_CLONES \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define ETASCATGEN_SIMD_CLONES
+#endif
+
+namespace etascatgen {
+
+/*
+ * Random number engines
+ * =====================
+ * Besides std::mt19937_64, the serial generators can draw from the
+ * following engines. All are seeded from the 64 bit seed and satisfy
+ * the UniformRandomBitGenerator requirements. They provide
+ *   - fill(w, n):  Fill w[0..n) with the next n random words, which is
+ *                  how the generators consume them (see pipeline.hpp).
+ */
+
+/*
+ * SplitMix64, used to expand the seed into the state of the engines:
+ */
+inline uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+
+/*
+ * xoshiro256++ (Blackman & Vigna, 2021):
+ */
+class Xoshiro256pp {
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256pp(uint64_t seed)
+    {
+        for (uint64_t& si : s)
+            si = splitmix64(seed);
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        const uint64_t result = std::rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = std::rotl(s[3], 45);
+        return result;
+    }
+
+    void fill(uint64_t* w, size_t n)
+    {
+        for (size_t k=0; k<n; ++k)
+            w[k] = (*this)();
+    }
+
+private:
+    uint64_t s[4];
+};
+
+
+/*
+ * PCG64 (O'Neill, 2014): a 128 bit LCG whose output is the XOR of the
+ * two halves of the state, rotated by its six highest bits (XSL-RR).
+ */
+class PCG64 {
+public:
+    typedef uint64_t result_type;
+
+    explicit PCG64(uint64_t seed)
+    {
+        const uint64_t s0 = splitmix64(seed);
+        const uint64_t s1 = splitmix64(seed);
+        const uint64_t i0 = splitmix64(seed);
+        const uint64_t i1 = splitmix64(seed);
+        inc = ((static_cast<uint128_t>(i0) << 64) | i1) | 1;
+        state = 0;
+        (*this)();
+        state += (static_cast<uint128_t>(s0) << 64) | s1;
+        (*this)();
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        state = state * MULTIPLIER + inc;
+        const uint64_t x = static_cast<uint64_t>(state >> 64)
+                           ^ static_cast<uint64_t>(state);
+        return std::rotr(x, static_cast<int>(state >> 122));
+    }
+
+    void fill(uint64_t* w, size_t n)
+    {
+        for (size_t k=0; k<n; ++k)
+            w[k] = (*this)();
+    }
+
+private:
+    typedef unsigned __int128 uint128_t;
+
+    static constexpr uint128_t MULTIPLIER
+        = (static_cast<uint128_t>(2549297995355413924ULL) << 64)
+          | 4865540595714422341ULL;
+
+    uint128_t state;
+    uint128_t inc;
+};
+
+
+/*
+ * Philox4x64-10 keyed by (seed, KEY), where the counter (0, 0, 0, k)
+ * yields the k'th block of four words. The highest bits of KEY
+ * separate it from the keys of the cluster method and the event streams
+ * (see eventstream.hpp). The blocks of `fill` are independent, so that
+ * the loop over them is branch-free.
+ */
+class PhiloxEngine {
+public:
+    typedef uint64_t result_type;
+
+    explicit PhiloxEngine(uint64_t seed) : key({seed, KEY})
+    {}
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if (i == 4){
+            block = philox4x64({0, 0, 0, k++}, key);
+            i = 0;
+        }
+        return block[i++];
+    }
+
+    void fill(uint64_t* w, size_t n)
+    {
+        /* Drain the current block, then continue with whole blocks: */
+        for (; n > 0 && i < 4; --n)
+            *w++ = block[i++];
+        const size_t m = n / 4;
+        philox_fill(key, 0, 0, 0, k, m, w);
+        k += m;
+        for (size_t j=4*m; j<n; ++j)
+            w[j] = (*this)();
+    }
+
+private:
+    static constexpr uint64_t KEY = uint64_t(1) << 62;
+
+    philox_key_t key;
+    uint64_t k = 0;
+    philox_ctr_t block;
+    unsigned int i = 4;
+};
+
+
+/*
+ * An external source of random words (see BitSource). It yields one
+ * word per call, so that `fill` calls it in a tight loop, away from the
+ * event loop.
+ */
+class ExternalEngine {
+public:
+    typedef uint64_t result_type;
+
+    explicit ExternalEngine(BitSource bits) : bits(bits)
+    {}
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return bits.next_uint64(bits.state);
+    }
+
+    void fill(uint64_t* w, size_t n)
+    {
+        for (size_t k=0; k<n; ++k)
+            w[k] = bits.next_uint64(bits.state);
+    }
+
+private:
+    BitSource bits;
+};
+
+
+/*
+ * The engine selected at run time, or the external bit source if set.
+ * The generators draw from it in blocks, so that the selection costs
+ * one dispatch per block:
+ */
+class RandomSource {
+public:
+    RandomSource(Engine engine, uint64_t seed, BitSource bits = BitSource())
+       : source(make(engine, seed, bits))
+    {}
+
+    void fill(uint64_t* w, size_t n)
+    {
+        std::visit([w, n](auto& e)
+        {
+            if constexpr (requires { e.fill(w, n); }){
+                e.fill(w, n);
+            } else {
+                for (size_t k=0; k<n; ++k)
+                    w[k] = e();
+            }
+        }, source);
+    }
+
+private:
+    typedef std::variant<std::mt19937_64, Xoshiro256pp, PCG64,
+                         PhiloxEngine, ExternalEngine> source_t;
+
+    source_t source;
+
+    static source_t make(Engine engine, uint64_t seed, BitSource bits)
+    {
+        if (bits)
+            return ExternalEngine(bits);
+        switch (engine){
+            case Engine::xoshiro256pp:
+                return Xoshiro256pp(seed);
+            case Engine::pcg64:
+                return PCG64(seed);
+            case Engine::philox:
+                return PhiloxEngine(seed);
+            default:
+                return std::mt19937_64(seed);
+        }
+    }
+};
+
+
+/*
+ * Convert n random words to uniforms in (0,1]. The highest 52 bits of
+ * a word form the mantissa of a double in [1,2), which is subtracted
+ * from two. Unlike an integer conversion, this vectorizes with AVX2.
+ */
+ETASCATGEN_SIMD_CLONES
+inline void uniform_block(const uint64_t* w, double* u, size_t n)
+{
+    for (size_t k=0; k<n; ++k)
+        u[k] = 2.0 - std::bit_cast<double>(
+            (w[k] >> 12) | 0x3FF0000000000000ULL
+        );
+}
+
+}
+
+#endif
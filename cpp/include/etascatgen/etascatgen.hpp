@@ -22,8 +22,13 @@
 #ifndef ETASCATGEN_ETASCATGEN_HPP
 #define ETASCATGEN_ETASCATGEN_HPP
 
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
 #include <cyantities/unit.hpp>
 #include <cyantities/quantitywrap.hpp>
+#include <etascatgen/arena.hpp>
 #include <boost/units/quantity.hpp>
 #include <boost/units/systems/si/time.hpp>
 #include <boost/units/systems/si/frequency.hpp>
@@ -38,6 +43,307 @@ using Time = bu::quantity<bu::si::time, double>;
 using Frequency = bu::quantity<bu::si::frequency, double>;
 using Scalar = bu::quantity<bu::si::dimensionless, double>;
 
+/*
+ * The algorithm used to generate the catalog:
+ *  - sequential: Generate one event after the other from a priority
+ *                queue of the intensity components (the reference
+ *                implementation).
+ *  - cluster:    Use the Poisson cluster (branching) representation of
+ *                the Hawkes process. Background events are drawn in
+ *                time windows and their clusters are built generation
+ *                by generation before the window is sorted by time.
+ *  - exponential_sum:
+ *                Approximate the Omori kernel by a sum of exponentials
+ *                and simulate the resulting Markovian Hawkes process.
+ *                The memory does not grow with the number of active
+ *                parents.
+ */
+enum class Method {
+    sequential,
+    cluster,
+    exponential_sum
+};
+
+/*
+ * The priority queue of the intensity components used by the
+ * sequential method:
+ *  - binary: std::priority_queue (a binary heap).
+ *  - dary:   A 4-ary heap, which has half the depth of the binary heap
+ *            and keeps the children of a node within one cache line.
+ *  - radix:  A radix heap on the bit pattern of the occurrence times.
+ *            This exploits that the times are popped in increasing
+ *            order, so that a push is a mere append.
+ * All queues yield the same catalog.
+ */
+enum class Queue {
+    binary,
+    dary,
+    radix
+};
+
+/*
+ * How the sequential method samples the descendants of an event:
+ *  - clock: One at a time, by advancing the event's transformed Omori
+ *           clock with an exponential variate whenever the previous
+ *           descendant occurs.
+ *  - count: Draw the total number of descendants once, then produce
+ *           their times in increasing order (in blocks for events with
+ *           many descendants).
+ * Both sample the same process but yield different catalogs.
+ */
+enum class Sampling {
+    clock,
+    count
+};
+
+/*
+ * The random number engine of the sequential and exponential_sum
+ * methods (see engine.hpp):
+ *  - mt19937_64:   std::mt19937_64.
+ *  - xoshiro256pp: xoshiro256++ (Blackman & Vigna, 2021).
+ *  - pcg64:        PCG64, the 128 bit LCG with the XSL-RR output
+ *                  (O'Neill, 2014).
+ *  - philox:       Philox4x64-10 (Salmon et al., 2011), which fills
+ *                  blocks of random numbers in parallel.
+ * The engines yield different catalogs for the same seed.
+ */
+enum class Engine {
+    mt19937_64,
+    xoshiro256pp,
+    pcg64,
+    philox
+};
+
+/*
+ * An external source of random words, such as the bitgen_t of a NumPy
+ * BitGenerator: next_uint64(state) returns the next word. The caller
+ * guarantees that nothing else uses the state during the generation.
+ */
+struct BitSource {
+    void* state = nullptr;
+    uint64_t (*next_uint64)(void*) = nullptr;
+
+    explicit operator bool() const
+    {
+        return next_uint64 != nullptr;
+    }
+};
+
+/*
+ * The time kernel of the triggered intensity, normalized to unit
+ * integral so that the offspring fraction is the branching ratio
+ * for all kernels:
+ *  - omori:           The modified Omori law (t + c) ** -p.
+ *  - exponential:     exp(-t / c).
+ *  - tapered_omori:   The modified Omori law whose survival function is
+ *                     tapered by exp(-t / tau).
+ *  - truncated_omori: The modified Omori law cut off at t = tau.
+ *  - custom:          The shape `kernel_function` of the delay in units
+ *                     of c, cut off at t = tau. Sampled by thinning
+ *                     (C++ interface only).
+ * The exponential_sum method supports only the Omori kernel, and the
+ * count sampling does not support the custom kernel.
+ */
+enum class Kernel {
+    omori,
+    exponential,
+    tapered_omori,
+    truncated_omori,
+    custom
+};
+
+/*
+ * The magnitude distribution:
+ *  - gutenberg_richter:
+ *             The Gutenberg-Richter law truncated to [Mmin, Mmax].
+ *  - tapered_gutenberg_richter:
+ *             The tapered Gutenberg-Richter law with corner magnitude
+ *             `corner_magnitude`, truncated to [Mmin, Mmax].
+ *  - table:   An empirical or binned magnitude-frequency table. The
+ *             magnitudes `magnitude_table` are drawn with probabilities
+ *             proportional to `magnitude_weights` (uniform if empty).
+ */
+enum class Magnitudes {
+    gutenberg_richter,
+    tapered_gutenberg_richter,
+    table
+};
+
+/*
+ * The background rate mu(t) = mu_0 * m(t):
+ *  - constant:           m(t) = 1.
+ *  - piecewise_constant: m(t) = background_factors[k] between the
+ *                        knots background_times[k] and [k+1].
+ *  - piecewise_linear:   m(t) interpolates background_factors linearly
+ *                        between the knots background_times.
+ * Outside the knots, m(t) continues with the value at the first or
+ * last knot.
+ */
+enum class Background {
+    constant,
+    piecewise_constant,
+    piecewise_linear
+};
+
+/*
+ * The initial state of the sequential method:
+ *  - empty:      Start without any past events. The catalog then begins
+ *                below the stationary rate and builds up its aftershock
+ *                activity over time, which the burn-in of N_skip events
+ *                (or auto_burn_in) has to cover.
+ *  - stationary: Start from a synthetic history: the clusters of the
+ *                background events within the init_window seconds
+ *                before t = 0 are simulated in parallel, and the past
+ *                events that are expected to have more than
+ *                init_tolerance direct descendants after t = 0 become
+ *                the initial parents. The activity of events before
+ *                -init_window is missing, so that init_window should
+ *                cover the decay of the kernel. A smaller
+ *                init_tolerance keeps more of the history. Then little
+ *                to no burn-in is needed.
+ * The cluster and exponential_sum methods support only the empty
+ * initialization.
+ */
+enum class Initialization {
+    empty,
+    stationary
+};
+
+/*
+ * Options steering the catalog generation:
+ *  - method:  The generation algorithm.
+ *  - queue:   The priority queue of the sequential method.
+ *  - sampling: How the sequential method samples the descendants.
+ *  - kernel:  The time kernel.
+ *  - kernel_tau:
+ *             Taper or cutoff time of the tapered and truncated Omori
+ *             kernels and the custom kernel in units of c.
+ *  - kernel_function:
+ *             The custom kernel shape g(t / c), which need not be
+ *             normalized.
+ *  - magnitudes, corner_magnitude, magnitude_table, magnitude_weights:
+ *             The magnitude distribution and its parameters.
+ *  - background, background_times, background_factors:
+ *             The forcing of the background rate. The knots are given
+ *             in seconds.
+ *  - kernel_rtol, kernel_horizon:
+ *             Maximum relative error of the sum of exponentials on the
+ *             time interval [0, kernel_horizon * c] (exponential_sum
+ *             method).
+ *  - initialization, init_window, init_tolerance:
+ *             The initial state of the sequential method, the time
+ *             span in seconds of the synthetic history before t = 0,
+ *             and the threshold of the expected number of direct
+ *             descendants after t = 0 above which a past event is
+ *             kept (see Initialization).
+ *  - auto_burn_in, burn_in_window, burn_in_tolerance:
+ *             Whether ETAS_generate_catalog_M_t ends the burn-in
+ *             automatically (see AutoCountSink) instead of after
+ *             N_skip events, which then bounds the burn-in. The
+ *             statistics are taken over windows of burn_in_window
+ *             events, doubling in size, until they are stable within
+ *             burn_in_tolerance.
+ *  - retire_tolerance:
+ *             If positive, the sequential method retires a parent
+ *             once its expected number of further descendants falls
+ *             below retire_tolerance instead of drawing them, which
+ *             bounds the parent table for heavy-tailed kernels at
+ *             the cost of a bias that is reported in GenerationInfo.
+ *  - aggregate_age, aggregate_width:
+ *             If aggregate_age is positive, the sequential method
+ *             hands parents over to super-parents once they reach the
+ *             age aggregate_age * c. Parents whose times differ by at
+ *             most aggregate_width times their age share a super-parent
+ *             (see superparent.hpp).
+ *  - engine: The random number engine of the sequential and
+ *             exponential_sum methods.
+ *  - bit_source:
+ *             If set, replaces the engine. It cannot be used for
+ *             ensembles or sweeps, whose members run concurrently,
+ *             apart from the shared burn-in of a forked ensemble.
+ *  - rng_thread:
+ *             If true, the sequential and exponential_sum methods
+ *             run their random number engine on a separate producer
+ *             thread (see pipeline.hpp). The catalog is identical.
+ *             The thread sleeps while it is ahead of the generator,
+ *             so that each member of an ensemble or sweep can run
+ *             one next to the workers.
+ *  - threads: Number of threads used by the cluster method
+ *             (0: use all cores). The catalog is bitwise identical
+ *             for any number of threads. Ensembles use the threads
+ *             across their members instead.
+ */
+struct GenerationOptions {
+    Method method = Method::sequential;
+    Queue queue = Queue::radix;
+    Sampling sampling = Sampling::clock;
+    Kernel kernel = Kernel::omori;
+    double kernel_tau = 1e6;
+    std::function<double(double)> kernel_function;
+    Magnitudes magnitudes = Magnitudes::gutenberg_richter;
+    double corner_magnitude = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> magnitude_table;
+    std::vector<double> magnitude_weights;
+    Background background = Background::constant;
+    std::vector<double> background_times;
+    std::vector<double> background_factors;
+    double kernel_rtol = 1e-3;
+    double kernel_horizon = 1e8;
+    Initialization initialization = Initialization::empty;
+    double init_window = 0.0;
+    double init_tolerance = 1e-6;
+    bool auto_burn_in = false;
+    size_t burn_in_window = 10000;
+    double burn_in_tolerance = 0.05;
+    double retire_tolerance = 0.0;
+    double aggregate_age = 0.0;
+    double aggregate_width = 0.1;
+    Engine engine = Engine::mt19937_64;
+    BitSource bit_source;
+    bool rng_thread = false;
+    unsigned int threads = 1;
+};
+
+/*
+ * Diagnostics reported back by the catalog generation:
+ *  - kernel_error: Achieved maximum relative error of the approximated
+ *                  kernel (exponential_sum method, NaN otherwise).
+ *  - kernel_terms: Number of exponential terms (exponential_sum).
+ *  - burn_in_events, burn_in_converged:
+ *                  Length of the automatic burn-in, and whether its
+ *                  statistics converged before reaching N_skip.
+ *  - burn_in_rate_ratio, burn_in_branching, burn_in_queue_size:
+ *                  The statistics of the last burn-in window: the event
+ *                  rate relative to the stationary rate, the fraction
+ *                  of triggered events, and the number of active
+ *                  parents at its end (sequential method only, NaN
+ *                  otherwise).
+ *  - retired_parents, retired_offspring:
+ *                  Number of parents retired under retire_tolerance,
+ *                  and the expected number of descendants discarded
+ *                  with them (for thinned kernels, an upper bound).
+ *  - parent_capacity:
+ *                  Peak number of parents held at once by the
+ *                  sequential method.
+ *  - joined_parents, super_parents:
+ *                  Number of parents handed over to super-parents, and
+ *                  the peak number of super-parents.
+ */
+struct GenerationInfo {
+    double kernel_error = std::numeric_limits<double>::quiet_NaN();
+    size_t kernel_terms = 0;
+    size_t burn_in_events = 0;
+    bool burn_in_converged = false;
+    double burn_in_rate_ratio = std::numeric_limits<double>::quiet_NaN();
+    double burn_in_branching = std::numeric_limits<double>::quiet_NaN();
+    double burn_in_queue_size = std::numeric_limits<double>::quiet_NaN();
+    size_t retired_parents = 0;
+    double retired_offspring = 0.0;
+    size_t parent_capacity = 0;
+    size_t joined_parents = 0;
+    size_t super_parents = 0;
+};
+
 /*
  * Earthquake with magnitude and occurrence time (no spatial information):
  */
@@ -53,10 +359,122 @@ void ETAS_generate_catalog_M_t(
     double offspring_fraction,
     const size_t N_skip,
     size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
     cyantities::QuantityWrapper& Mi,
     cyantities::QuantityWrapper& ti
 );
 
+/*
+ * Generate all events within the time window [T0, T1) into the
+ * catalog arena. The process starts at t = 0, and the events before T0
+ * are discarded without being stored.
+ */
+void ETAS_generate_catalog_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogArena& catalog
+);
+
+/*
+ * Generate an ensemble of independent catalogs, one per seed, within
+ * the time window [T0, T1) (see ETAS_generate_catalog_M_t_window).
+ * The members are generated concurrently on `options.threads`
+ * threads, each member single-threaded. Member k is identical to the
+ * catalog generated by ETAS_generate_catalog_M_t_window with seed
+ * seeds[k]. A custom kernel function is called concurrently. The
+ * diagnostics in `info` cover all members: the counts are summed, and
+ * the peaks and kernel diagnostics are the maxima over the members.
+ */
+void ETAS_generate_ensemble_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    const std::vector<size_t>& seeds,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogEnsemble& ensemble
+);
+
+/*
+ * Generate an ensemble within the time window [T0, T1) from a single
+ * burn-in: The process is generated once with `seed` up to T0, and
+ * its state is then forked into one member per seed in `seeds`. The
+ * members continue from T0 with independent random numbers. They
+ * share the history before T0 and are hence independent only
+ * conditional on it. Requires the sequential method. The diagnostics
+ * in `info` cover the burn-in and all members as for
+ * ETAS_generate_ensemble_M_t_window.
+ */
+void ETAS_generate_forked_ensemble_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    size_t seed,
+    const std::vector<size_t>& seeds,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogEnsemble& ensemble
+);
+
+/*
+ * Generate catalogs of N events for a sweep over P grid points of the
+ * parameters alpha, p, c, and offspring_fraction, each given as an
+ * array of size P. All grid points are validated before any catalog
+ * is generated, and they are generated concurrently on
+ * `options.threads` threads using the same seed. Grid point i is
+ * written to the events [i*N, (i+1)*N) of Mi and ti, which have size
+ * P * N. The diagnostics in `info` cover all grid points as for
+ * ETAS_generate_ensemble_M_t_window.
+ */
+void ETAS_generate_sweep_M_t(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    const std::vector<double>& alpha,
+    const std::vector<double>& p,
+    cyantities::QuantityWrapper& c,
+    const std::vector<double>& offspring_fraction,
+    const size_t N_skip,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    cyantities::QuantityWrapper& Mi,
+    cyantities::QuantityWrapper& ti
+);
+
+/*
+ * The values of a time quantity in seconds (used to fill the tables of
+ * the generation options):
+ */
+std::vector<double> to_seconds(cyantities::QuantityWrapper& t);
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+ * Pre-generated background events and magnitudes.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_EVENTSTREAM_HPP
+#define ETASCATGEN_EVENTSTREAM_HPP
+
+#include <etascatgen/engine.hpp>
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/exponential.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <etascatgen/philox.hpp>
+#include <etascatgen/process.hpp>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace etascatgen {
+
+/*
+ * Event streams
+ * =============
+ * The background events and the magnitudes of all events do not depend
+ * on the triggered events. The serial generators hence draw them ahead
+ * of time in blocks of BLOCK values, which leaves only the triggering
+ * to the event loop:
+ *   - The background events form a homogeneous Poisson process in the
+ *     cumulative forcing, so that a block of unit exponentials becomes
+ *     a block of occurrence times by a prefix sum (see
+ *     `next_background_occurrences`). The exponentials follow from the
+ *     batched ziggurat (see exponential.hpp).
+ *   - The magnitudes follow from the inverse CDF of the magnitude
+ *     policy, applied to a block of uniforms.
+ * Both streams use Philox4x64-10 keyed by (seed, STREAM), where the
+ * counter (s, 0, 0, k) yields the k'th block of four random words of
+ * the background (s = 0) and the magnitudes (s = 1). The few words
+ * rejected by the ziggurat draw replacements from the counters
+ * (2, 0, 0, k). The two highest bits of STREAM separate the key from
+ * those of the cluster method (see catgen_M_t_cluster.cpp) and the
+ * Philox engine (see engine.hpp).
+ */
+template<typename magnitudes_t>
+class EventStream {
+public:
+    EventStream(
+        const Process_M_t& process,
+        const magnitudes_t& magnitudes,
+        size_t seed
+    ) : process(process), magnitudes(magnitudes), key({seed, STREAM}),
+        rejected(key, 2, 0, 0)
+    {}
+
+    /*
+     * Fork the streams with a new seed:
+     */
+    EventStream(const EventStream& state, size_t seed)
+       : EventStream(state.process, state.magnitudes, seed)
+    {}
+
+    /*
+     * Discard the pending background events and continue after t:
+     */
+    void restart(Time t)
+    {
+        t_last = t;
+        i_bg = BLOCK;
+    }
+
+    /* The next background event: */
+    Time next_background()
+    {
+        if (i_bg == BLOCK)
+            refill_background();
+        return t_bg[i_bg++];
+    }
+
+    /* The magnitude of the next event: */
+    magnitude_t next_magnitude()
+    {
+        if (i_M == BLOCK)
+            refill_magnitudes();
+        return M[i_M++];
+    }
+
+private:
+    static constexpr size_t BLOCK = 256;
+    static constexpr uint64_t STREAM = uint64_t(3) << 62;
+
+    const Process_M_t& process;
+    const magnitudes_t& magnitudes;
+    philox_key_t key;
+
+    /* Replacements for the words rejected by the ziggurat: */
+    PhiloxStream rejected;
+
+    /* Scratch space for the random words and variates: */
+    std::array<uint64_t,BLOCK> w;
+    std::array<double,BLOCK> u;
+
+    /*
+     * Block of background events, position within, the last event
+     * before the block, and the counter of the next block:
+     */
+    std::array<Time,BLOCK> t_bg;
+    size_t i_bg = BLOCK;
+    Time t_last = 0.0 * bu::si::seconds;
+    uint64_t k_bg = 0;
+
+    /* Block of magnitudes: */
+    std::array<magnitude_t,BLOCK> M;
+    size_t i_M = BLOCK;
+    uint64_t k_M = 0;
+
+    void refill_background()
+    {
+        philox_fill(key, 0, 0, 0, k_bg, BLOCK / 4, w.data());
+        exponential_block(w.data(), u.data(), BLOCK, rejected);
+        k_bg += BLOCK / 4;
+        next_background_occurrences(
+            u.data(), BLOCK, t_last, t_bg.data(), process
+        );
+        t_last = t_bg[BLOCK-1];
+        i_bg = 0;
+    }
+
+    void refill_magnitudes()
+    {
+        philox_fill(key, 1, 0, 0, k_M, BLOCK / 4, w.data());
+        uniform_block(w.data(), u.data(), BLOCK);
+        k_M += BLOCK / 4;
+        for (size_t k=0; k<BLOCK; ++k)
+            M[k] = magnitudes.draw(u[k]);
+        i_M = 0;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Ziggurat sampler of unit exponential variates.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_EXPONENTIAL_HPP
+#define ETASCATGEN_EXPONENTIAL_HPP
+
+#include <etascatgen/engine.hpp>
+#include <etascatgen/philox.hpp>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace etascatgen {
+
+/*
+ * Exponential ziggurat
+ * ====================
+ * The unit exponential variates of the event loops, which would
+ * otherwise cost a logarithm each, follow from the ziggurat method of
+ * Marsaglia & Tsang (2000). The density exp(-x) is covered by N = 256
+ * layers of equal area V: the base layer 0, which comprises the tail
+ * beyond x[N-1] = R, and the boxes i = 1, ..., N-1 spanning [0, x[i])
+ * in x and [exp(-x[i]), exp(-x[i-1])] in density, where x[0] = 0.
+ *
+ * A random word yields the layer i from its lowest eight bits and a
+ * 52 bit integer j from its highest bits. The candidate
+ *    x = j * w[i],
+ * with w[i] = x[i] / 2^52 (the base layer uses its virtual width
+ * V / exp(-R)), is accepted immediately if j < k[i], that is, if it lies
+ * within the box above. This holds for about 98.9% of the words and
+ * requires neither a branch nor a transcendental function. Otherwise,
+ * the candidate is decided in the wedge of box i by a second uniform,
+ * or the base layer draws from the tail R + E by inversion.
+ *
+ * The batched variant evaluates the fast path over a block of words,
+ * which the compiler vectorizes with gathers, and completes the few
+ * rejected entries with the scalar slow path.
+ */
+struct ExponentialZiggurat {
+    static constexpr double R = 7.697117470131487;
+    static constexpr double V = 3.949659822581572e-3;
+    static constexpr double M = 0x1.0p52;
+
+    int64_t k[256];
+    double w[256];
+    double f[256];
+
+    ExponentialZiggurat()
+    {
+        const double q = V / std::exp(-R);
+        k[0] = static_cast<int64_t>(R / q * M);
+        k[1] = 0;
+        w[0] = q / M;
+        w[255] = R / M;
+        f[0] = 1.0;
+        f[255] = std::exp(-R);
+        double x = R;
+        for (int i=254; i>=1; --i){
+            const double x_next = -std::log(V / x + std::exp(-x));
+            k[i+1] = static_cast<int64_t>(x_next / x * M);
+            x = x_next;
+            f[i] = std::exp(-x);
+            w[i] = x / M;
+        }
+    }
+};
+
+inline const ExponentialZiggurat exponential_ziggurat;
+
+
+/*
+ * The fast path for the random word x: the exponential variate, or -1
+ * if x has to be decided by the slow path. Branch-free.
+ */
+inline double exponential_fast(uint64_t x)
+{
+    const ExponentialZiggurat& z = exponential_ziggurat;
+    const uint64_t i = x & 0xFF;
+    const int64_t j = static_cast<int64_t>(x >> 12);
+
+    /* Exact conversion of j < 2^52 to double, which vectorizes: */
+    const double jd = std::bit_cast<double>(
+        static_cast<uint64_t>(j) | 0x4330000000000000ULL
+    ) - 0x1.0p52;
+    const double E = jd * z.w[i];
+
+    /* Select E or -1 by a mask rather than a branch, which vectorizes: */
+    const uint64_t accept = -static_cast<uint64_t>(j < z.k[i]);
+    return std::bit_cast<double>(
+        (std::bit_cast<uint64_t>(E) & accept)
+        | (std::bit_cast<uint64_t>(-1.0) & ~accept)
+    );
+}
+
+
+/*
+ * The complete ziggurat for the random word x, drawing further words
+ * from rng if x is rejected:
+ */
+template<typename rng_t>
+double exponential_slow(uint64_t x, rng_t& rng)
+{
+    const ExponentialZiggurat& z = exponential_ziggurat;
+    while (true){
+        const unsigned int i = x & 0xFF;
+        const int64_t j = static_cast<int64_t>(x >> 12);
+        const double E = static_cast<double>(j) * z.w[i];
+        if (j < z.k[i])
+            return E;
+        if (i == 0)
+            return ExponentialZiggurat::R - std::log(uniform_0_1(rng()));
+        const double y = z.f[i] + uniform_0_1(rng()) * (z.f[i-1] - z.f[i]);
+        if (y < std::exp(-E))
+            return E;
+        x = rng();
+    }
+}
+
+
+/*
+ * A unit exponential variate:
+ */
+template<typename rng_t>
+double exponential(rng_t& rng)
+{
+    const uint64_t x = rng();
+    const double E = exponential_fast(x);
+    if (E >= 0.0) [[likely]]
+        return E;
+    return exponential_slow(x, rng);
+}
+
+
+/*
+ * The fast path over the n words w, marking the rejected entries of E
+ * by -1. Since the tables are initialized at run time, E needs to be
+ * declared to not alias them for the loop to vectorize.
+ */
+ETASCATGEN_SIMD_CLONES
+inline void exponential_block_fast(
+    const uint64_t* w,
+    double* __restrict E,
+    size_t n
+)
+{
+    for (size_t k=0; k<n; ++k)
+        E[k] = exponential_fast(w[k]);
+}
+
+
+/*
+ * Fill E with the n unit exponentials of the words w. The rejected
+ * words draw further words from rng.
+ */
+template<typename rng_t>
+void exponential_block(const uint64_t* w, double* E, size_t n, rng_t& rng)
+{
+    exponential_block_fast(w, E, n);
+    for (size_t k=0; k<n; ++k)
+        if (E[k] < 0.0)
+            E[k] = exponential_slow(w[k], rng);
+}
+
+}
+
+#endif
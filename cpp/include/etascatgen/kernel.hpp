@@ -0,0 +1,437 @@
+/*
+ * Triggering kernels of the ETAS process.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_KERNEL_HPP
+#define ETASCATGEN_KERNEL_HPP
+
+#include <etascatgen/process.hpp>
+#include <etascatgen/lambertw.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Kernel policies
+ * ===============
+ * The generators are templated on the time kernel g(t) of the triggered
+ * intensity. The kernels are normalized to a unit integral, so that the
+ * offspring fraction is the branching ratio for every kernel, and the
+ * expected number of direct descendants of an event of magnitude M is
+ * kappa * f(M) (see `expected_offspring`).
+ * Each kernel provides the closed-form survival function
+ *    S(t) = int_t^oo g(t') dt'
+ * of the delay of a descendant, that is, the compensator 1 - S(t), and
+ * its inverse. Since S decreases from 1 to 0, the descendants of a
+ * parent form a homogeneous Poisson process in S (see the transformed
+ * clock in process.hpp).
+ *   - survival(t):                 S(t)
+ *   - inverse_survival(sigma):     S^-1(sigma) for sigma in (0,1]
+ *   - inverse_log_survival(ls):    S^-1(exp(ls))
+ * Kernels without a closed-form inverse (ThinnedKernel) provide these
+ * for an envelope of the kernel and additionally
+ *   - acceptance(t):               Probability to accept a candidate
+ *                                  at delay t.
+ *   - envelope_factor:             The integral of the envelope relative
+ *                                  to that of the kernel.
+ */
+
+
+/*
+ * The modified Omori kernel g(t) ~ (t + c) ** -p, with
+ *    S(t) = ((t + c) / c) ** (1-p).
+ */
+struct OmoriKernel {
+    Time c;
+    double inv_1mp;
+
+    OmoriKernel(const Process_M_t& process, double)
+       : c(process.c), inv_1mp(1.0 / (1.0 - process.p))
+    {}
+
+    double survival(Time t) const
+    {
+        return std::pow((t + c) / c, 1.0 / inv_1mp);
+    }
+
+    Time inverse_survival(double sigma) const
+    {
+        return c * (std::pow(sigma, inv_1mp) - 1.0);
+    }
+
+    Time inverse_log_survival(double log_sigma) const
+    {
+        return c * std::expm1(inv_1mp * log_sigma);
+    }
+};
+
+
+/*
+ * The exponential kernel g(t) ~ exp(-t / c), with
+ *    S(t) = exp(-t / c).
+ */
+struct ExponentialKernel {
+    Time c;
+
+    ExponentialKernel(const Process_M_t& process, double)
+       : c(process.c)
+    {}
+
+    double survival(Time t) const
+    {
+        return std::exp(-t / c);
+    }
+
+    Time inverse_survival(double sigma) const
+    {
+        return -c * std::log(sigma);
+    }
+
+    Time inverse_log_survival(double log_sigma) const
+    {
+        return -c * log_sigma;
+    }
+};
+
+
+/*
+ * The modified Omori kernel with an exponential taper at time scale
+ * tau. We taper the survival function,
+ *    S(t) = ((t + c) / c) ** (1-p) * exp(-t / tau),
+ * which corresponds to the kernel
+ *    g(t) ~ (t + c) ** -p * exp(-t / tau) * (1 + (t + c) / (tau (p-1)))
+ * and can be inverted in closed form using the Lambert W function:
+ * With a = p-1 and z = (t + c) / (a * tau), S(t) = sigma becomes
+ *    z + log(z) = (c / tau - log(sigma)) / a + log(c / (a tau)) = L
+ * so that z = W(exp(L)).
+ */
+struct TaperedOmoriKernel {
+    Time c;
+    Time tau;
+    double a;
+    double L0;
+
+    TaperedOmoriKernel(const Process_M_t& process, double tau_c)
+       : c(process.c), tau(tau_c * process.c), a(process.p - 1.0),
+         L0(1.0 / (a * tau_c) - std::log(a * tau_c))
+    {}
+
+    double survival(Time t) const
+    {
+        return std::pow((t + c) / c, -a) * std::exp(-t / tau);
+    }
+
+    Time inverse_survival(double sigma) const
+    {
+        return inverse_log_survival(std::log(sigma));
+    }
+
+    Time inverse_log_survival(double log_sigma) const
+    {
+        return a * tau * lambert_w_exp(L0 - log_sigma / a) - c;
+    }
+};
+
+
+/*
+ * The modified Omori kernel truncated at time T. With the Omori
+ * survival function S_O,
+ *    S(t) = (S_O(t) - S_O(T)) / (1 - S_O(T))   for t < T
+ * and zero beyond.
+ */
+struct TruncatedOmoriKernel {
+    OmoriKernel omori;
+    double S_T;
+
+    TruncatedOmoriKernel(const Process_M_t& process, double T_c)
+       : omori(process, T_c),
+         S_T(omori.survival(T_c * process.c))
+    {}
+
+    double survival(Time t) const
+    {
+        return std::max((omori.survival(t) - S_T) / (1.0 - S_T), 0.0);
+    }
+
+    Time inverse_survival(double sigma) const
+    {
+        return omori.inverse_survival(sigma * (1.0 - S_T) + S_T);
+    }
+
+    Time inverse_log_survival(double log_sigma) const
+    {
+        return inverse_survival(std::exp(log_sigma));
+    }
+};
+
+
+/*
+ * An arbitrary kernel shape g(x), given as a callable of the delay
+ * x = t / c, cut off at x = X. Since g cannot be inverted in closed
+ * form, the descendants are sampled by thinning (Ogata, 1981): The
+ * kernel is bounded by a piecewise-constant envelope B(x) >= g(x),
+ * whose survival function is inverted in closed form by the
+ * generators, and each candidate is accepted with probability
+ * g(x) / B(x) (see `acceptance`). The envelope integrates to
+ * `envelope_factor` >= 1 relative to g, which is normalized
+ * numerically.
+ *
+ * The envelope is built adaptively: Starting from geometrically
+ * growing segments, the segment whose envelope exceeds its kernel
+ * integral the most is bisected until the total envelope is within
+ * a fraction ENVELOPE_RTOL of the kernel integral, so that the
+ * acceptance rate stays high irrespective of the shape of g. On each
+ * segment, g is evaluated on a regular grid, and the bound is the
+ * maximum on the grid plus the largest difference between adjacent
+ * grid points as a slack for the variation between them. This bound is
+ * not guaranteed: a feature of g narrower than the grid can exceed it.
+ * Since the thinning would then silently accept all candidates there,
+ * `acceptance` throws if g exceeds the envelope at a candidate.
+ */
+class ThinnedKernel {
+public:
+    ThinnedKernel(
+        const Process_M_t& process,
+        double X,
+        const std::function<double(double)>& g
+    ) : c(process.c), g(g)
+    {
+        if (!g)
+            throw std::runtime_error("The custom kernel requires a kernel "
+                                     "function.");
+        if (!(X > 0.0) || !std::isfinite(X))
+            throw std::runtime_error("The cutoff of the custom kernel "
+                                     "needs to be positive and finite.");
+
+        /*
+         * Initial segments:
+         */
+        auto excess = [](const segment_t& s0, const segment_t& s1) -> bool
+        {
+            return s0.B * (s0.b - s0.a) - s0.I < s1.B * (s1.b - s1.a) - s1.I;
+        };
+        std::priority_queue<
+            segment_t, std::vector<segment_t>, decltype(excess)
+        > segments(excess);
+        double I = 0.0;
+        double Z = 0.0;
+        auto add = [&](double a, double b)
+        {
+            segment_t s = evaluate(a, b);
+            I += s.I;
+            Z += s.B * (b - a);
+            segments.push(s);
+        };
+        double a = 0.0;
+        for (double b = std::min(X, X_FIRST); a < X; b = std::min(2.0 * b, X)){
+            add(a, b);
+            a = b;
+        }
+
+        /*
+         * Refine:
+         */
+        while (Z > (1.0 + ENVELOPE_RTOL) * I && segments.size() < MAX_SEGMENTS){
+            const segment_t s = segments.top();
+            segments.pop();
+            I -= s.I;
+            Z -= s.B * (s.b - s.a);
+            const double m = 0.5 * (s.a + s.b);
+            add(s.a, m);
+            add(m, s.b);
+        }
+        if (!(I > 0.0))
+            throw std::runtime_error("The custom kernel integrates to zero.");
+
+        /*
+         * The envelope in order of the segments, and its cumulative
+         * integral normalized to the kernel integral:
+         */
+        std::vector<segment_t> seg;
+        seg.reserve(segments.size());
+        while (!segments.empty()){
+            seg.push_back(segments.top());
+            segments.pop();
+        }
+        std::sort(seg.begin(), seg.end(),
+            [](const segment_t& s0, const segment_t& s1) -> bool
+            {
+                return s0.a < s1.a;
+            }
+        );
+        x.resize(seg.size() + 1);
+        B.resize(seg.size());
+        E.resize(seg.size() + 1);
+        E[0] = 0.0;
+        for (size_t k=0; k<seg.size(); ++k){
+            x[k] = seg[k].a;
+            B[k] = seg[k].B;
+            E[k+1] = E[k] + seg[k].B * (seg[k].b - seg[k].a) / I;
+        }
+        x.back() = X;
+        envelope_factor = E.back();
+    }
+
+    /* Envelope integral relative to the kernel integral: */
+    double envelope_factor;
+
+    /*
+     * Survival function of the (normalized) envelope and its inverse:
+     */
+    double survival(Time t) const
+    {
+        const double xt = t / c;
+        if (xt >= x.back())
+            return 0.0;
+        const size_t k = segment(xt);
+        return 1.0 - (E[k] + (xt - x[k]) * (E[k+1] - E[k])
+                     / (x[k+1] - x[k])) / envelope_factor;
+    }
+
+    Time inverse_survival(double sigma) const
+    {
+        const double Es = (1.0 - sigma) * envelope_factor;
+        const size_t k = std::min<size_t>(
+            std::upper_bound(E.cbegin(), E.cend(), Es) - E.cbegin() - 1,
+            B.size() - 1
+        );
+        return c * std::min(
+            x[k] + (Es - E[k]) / (E[k+1] - E[k]) * (x[k+1] - x[k]),
+            x[k+1]
+        );
+    }
+
+    Time inverse_log_survival(double log_sigma) const
+    {
+        return inverse_survival(std::exp(log_sigma));
+    }
+
+    /*
+     * Probability to accept a candidate from the envelope at delay t:
+     */
+    double acceptance(Time t) const
+    {
+        const double xt = t / c;
+        const double p = g(xt) / B[segment(xt)];
+        if (!(p <= 1.0))
+            throw std::runtime_error(
+                "The custom kernel exceeds its envelope at x = "
+                + std::to_string(xt) + ". The kernel may vary on scales "
+                "too small for the grid of the envelope."
+            );
+        return p;
+    }
+
+private:
+    static constexpr double X_FIRST = 1.0 / 64;
+    static constexpr double ENVELOPE_RTOL = 0.02;
+    static constexpr size_t MAX_SEGMENTS = 1 << 14;
+    static constexpr size_t GRID = 8;
+
+    struct segment_t {
+        double a;
+        double b;
+        /* Bound of g and integral of g on [a,b]: */
+        double B;
+        double I;
+    };
+
+    Time c;
+    std::function<double(double)> g;
+    std::vector<double> x;
+    std::vector<double> B;
+    std::vector<double> E;
+
+    size_t segment(double xt) const
+    {
+        const size_t k = std::upper_bound(x.cbegin(), x.cend(), xt)
+                         - x.cbegin();
+        return std::min(std::max<size_t>(k, 1) - 1, B.size() - 1);
+    }
+
+    segment_t evaluate(double a, double b) const
+    {
+        /*
+         * Simpson's rule on the grid for the integral:
+         */
+        const double h = (b - a) / GRID;
+        double gmax = 0.0;
+        double dmax = 0.0;
+        double I = 0.0;
+        double g_prev = 0.0;
+        for (size_t i=0; i<=GRID; ++i){
+            const double gi = g(a + i * h);
+            if (!(gi >= 0.0) || !std::isfinite(gi))
+                throw std::runtime_error("The custom kernel needs to be "
+                                         "finite and non-negative.");
+            gmax = std::max(gmax, gi);
+            if (i > 0)
+                dmax = std::max(dmax, std::abs(gi - g_prev));
+            g_prev = gi;
+            I += ((i == 0 || i == GRID) ? 1.0 : ((i % 2 == 1) ? 4.0 : 2.0))
+                 * gi;
+        }
+        return segment_t(a, b, gmax + dmax, I * h / 3.0);
+    }
+};
+
+
+/*
+ * Call fun(kernel) with the kernel selected in the options.
+ */
+template<typename fun_t>
+void with_kernel(
+    const Process_M_t& process,
+    const GenerationOptions& options,
+    fun_t&& fun
+)
+{
+    switch (options.kernel){
+        case Kernel::omori:
+            fun(OmoriKernel(process, options.kernel_tau));
+            break;
+        case Kernel::exponential:
+            fun(ExponentialKernel(process, options.kernel_tau));
+            break;
+        case Kernel::tapered_omori:
+            fun(TaperedOmoriKernel(process, options.kernel_tau));
+            break;
+        case Kernel::truncated_omori:
+            fun(TruncatedOmoriKernel(process, options.kernel_tau));
+            break;
+        case Kernel::custom:
+            fun(ThinnedKernel(
+                process, options.kernel_tau, options.kernel_function
+            ));
+            break;
+        default:
+            throw std::runtime_error("Unknown kernel.");
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * The principal branch of the Lambert W function for large arguments.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_LAMBERTW_HPP
+#define ETASCATGEN_LAMBERTW_HPP
+
+#include <boost/math/special_functions/lambert_w.hpp>
+#include <cmath>
+
+namespace etascatgen {
+
+/*
+ * W(exp(L)), that is, the solution z of
+ *    z + log(z) = L,
+ * also for L where exp(L) overflows. There, we solve the equation by
+ * Newton iteration from z = L - log(L).
+ */
+inline double lambert_w_exp(double L)
+{
+    if (L < 20.0)
+        return boost::math::lambert_w0(std::exp(L));
+    double z = L - std::log(L);
+    for (int i=0; i<4; ++i)
+        z -= (z + std::log(z) - L) * z / (z + 1.0);
+    return z;
+}
+
+}
+
+#endif
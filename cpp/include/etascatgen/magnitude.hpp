@@ -0,0 +1,330 @@
+/*
+ * Magnitude distributions of the ETAS process.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_MAGNITUDE_HPP
+#define ETASCATGEN_MAGNITUDE_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/lambertw.hpp>
+#include <etascatgen/process.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Magnitude policies
+ * ==================
+ * The generators are templated on the magnitude distribution. Each
+ * policy maps a uniform random number u in [0,1] to a magnitude M and
+ * its productivity f(M) = exp(alpha * (M - Mmin)), which determines the
+ * expected number of direct descendants (see `expected_offspring`):
+ *   - draw(u):              magnitude_t {M, f(M)}
+ *   - mean_productivity():  The mean <f(M)> over the distribution,
+ *                           which normalizes the process to the
+ *                           offspring fraction.
+ */
+struct magnitude_t {
+    double M;
+    double f;
+};
+
+
+/*
+ * The Gutenberg-Richter law truncated to [Mmin, Mmax]:
+ *    P(M' >= M) ~ exp(-beta * (M - Mmin))
+ */
+struct GutenbergRichterMagnitudes {
+    double Mmin;
+    double Mmax;
+    double beta;
+    double alpha;
+
+    GutenbergRichterMagnitudes(
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha
+    ) : Mmin(Mmin), Mmax(Mmax), beta(beta), alpha(alpha)
+    {}
+
+    magnitude_t draw(double u) const
+    {
+        const double M = draw_magnitude(u, Mmin, Mmax, beta);
+        return magnitude_t(M, std::exp(alpha * (M - Mmin)));
+    }
+
+    double mean_productivity() const
+    {
+        const double Z = 1.0 - std::exp(-beta * (Mmax - Mmin));
+        if (alpha == beta){
+            /*
+             * Integrate a constant over M:
+             */
+            return beta * (Mmax - Mmin) / Z;
+        } else {
+            return beta * std::expm1((alpha - beta) * (Mmax - Mmin))
+                / ((alpha - beta) * Z);
+        }
+    }
+};
+
+
+/*
+ * The tapered Gutenberg-Richter law (Kagan, 2002) with corner
+ * magnitude Mc, truncated to [Mmin, Mmax]. In terms of the seismic
+ * moment relative to that of Mmin,
+ *    y = 10 ** (1.5 * (M - Mmin)),
+ * its survival function is
+ *    S(y) = y ** -b * exp((1 - y) / yc)
+ * with b = beta / (1.5 * ln(10)) and yc the relative corner moment.
+ * As for the tapered Omori kernel, S(y) = sigma can be inverted in
+ * closed form: With z = y / (b * yc),
+ *    z + log(z) = (1/yc - log(sigma)) / b - log(b * yc) = L
+ * so that z = W(exp(L)).
+ */
+struct TaperedGutenbergRichterMagnitudes {
+    double Mmin;
+    double alpha;
+    double b;
+    double yc;
+    double L0;
+    double S_max;
+    double mean_f;
+
+    TaperedGutenbergRichterMagnitudes(
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double Mc
+    ) : Mmin(Mmin), alpha(alpha), b(beta / (1.5 * std::log(10.0))),
+        yc(std::pow(10.0, 1.5 * (Mc - Mmin))),
+        L0(1.0 / (b * yc) - std::log(b * yc)),
+        S_max(survival(Mmax))
+    {
+        if (!std::isfinite(Mc))
+            throw std::runtime_error(
+                "The tapered Gutenberg-Richter law requires a finite "
+                "corner magnitude."
+            );
+
+        /*
+         * The mean productivity follows from integration by parts,
+         *    <f> = f(Mmin) + int f'(M) * (S(M) - S_max) / (1 - S_max) dM,
+         * using Simpson's rule.
+         */
+        constexpr size_t NM = 4096;
+        const double dM = (Mmax - Mmin) / NM;
+        double sum = 0.0;
+        for (size_t i=0; i<=NM; ++i){
+            const double M = Mmin + i * dM;
+            const double w = (i == 0 || i == NM) ? 1.0
+                             : ((i % 2 == 1) ? 4.0 : 2.0);
+            sum += w * alpha * std::exp(alpha * (M - Mmin))
+                * (survival(M) - S_max);
+        }
+        mean_f = 1.0 + sum * dM / (3.0 * (1.0 - S_max));
+    }
+
+    magnitude_t draw(double u) const
+    {
+        const double sigma = 1.0 - u * (1.0 - S_max);
+        const double y = b * yc * lambert_w_exp(L0 - std::log(sigma) / b);
+        const double M = Mmin + std::log10(y) / 1.5;
+        return magnitude_t(M, std::exp(alpha * (M - Mmin)));
+    }
+
+    double mean_productivity() const
+    {
+        return mean_f;
+    }
+
+private:
+    double survival(double M) const
+    {
+        const double y = std::pow(10.0, 1.5 * (M - Mmin));
+        return std::pow(y, -b) * std::exp((1.0 - y) / yc);
+    }
+};
+
+
+/*
+ * An empirical or binned magnitude-frequency table: magnitude M[k]
+ * occurs with a probability proportional to weight[k]. Sampling uses
+ * the alias method of Walker (1977) in the construction of Vose (1991),
+ * so that a draw costs one table lookup and no transcendental function
+ * irrespective of the number of bins. The productivity of each bin is
+ * precomputed.
+ * A single uniform u provides both the bin k = floor(K*u) and the
+ * acceptance test on the fractional part of K*u.
+ */
+class MagnitudeTable {
+public:
+    MagnitudeTable(
+        double Mmin,
+        double Mmax,
+        double alpha,
+        const std::vector<double>& M,
+        const std::vector<double>& weight
+    )
+    {
+        const size_t K = M.size();
+        if (K == 0)
+            throw std::runtime_error("The magnitude table is empty.");
+        if (K >= std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("The magnitude table is too large.");
+        if (!weight.empty() && weight.size() != K)
+            throw std::runtime_error(
+                "Sizes of the magnitude table and its weights not "
+                "compatible."
+            );
+
+        /*
+         * Normalized probabilities and productivity:
+         */
+        std::vector<double> P(K, 1.0);
+        if (!weight.empty())
+            P = weight;
+        double W = 0.0;
+        for (size_t k=0; k<K; ++k){
+            if (!(M[k] >= Mmin && M[k] <= Mmax))
+                throw std::runtime_error(
+                    "Magnitudes of the table need to be within [Mmin, Mmax]."
+                );
+            if (!(P[k] >= 0.0) || !std::isfinite(P[k]))
+                throw std::runtime_error(
+                    "Weights of the magnitude table need to be non-negative."
+                );
+            W += P[k];
+        }
+        if (!(W > 0.0))
+            throw std::runtime_error(
+                "Weights of the magnitude table sum to zero."
+            );
+        bins.resize(K);
+        mean_f = 0.0;
+        for (size_t k=0; k<K; ++k){
+            P[k] /= W;
+            bins[k].M = M[k];
+            bins[k].f = std::exp(alpha * (M[k] - Mmin));
+            mean_f += P[k] * bins[k].f;
+        }
+
+        /*
+         * Vose's construction of the alias table. Bin k keeps a fraction
+         * q[k] of its column in the scaled probabilities K * P and fills
+         * the remainder with its alias.
+         */
+        alias.resize(K);
+        std::vector<uint32_t> small;
+        std::vector<uint32_t> large;
+        for (size_t k=0; k<K; ++k){
+            P[k] *= K;
+            alias[k].q = 1.0;
+            alias[k].alias = k;
+            if (P[k] < 1.0)
+                small.push_back(k);
+            else
+                large.push_back(k);
+        }
+        while (!small.empty() && !large.empty()){
+            const uint32_t s = small.back();
+            small.pop_back();
+            const uint32_t l = large.back();
+            alias[s].q = P[s];
+            alias[s].alias = l;
+            P[l] -= 1.0 - P[s];
+            if (P[l] < 1.0){
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        /* The remainder is 1 up to round-off. */
+    }
+
+    magnitude_t draw(double u) const
+    {
+        const size_t K = bins.size();
+        const double x = u * K;
+        const size_t k = std::min(static_cast<size_t>(x), K - 1);
+        const size_t j = (x - k < alias[k].q) ? k : alias[k].alias;
+        return bins[j];
+    }
+
+    double mean_productivity() const
+    {
+        return mean_f;
+    }
+
+private:
+    struct alias_t {
+        double q;
+        uint32_t alias;
+    };
+
+    std::vector<alias_t> alias;
+    std::vector<magnitude_t> bins;
+    double mean_f;
+};
+
+
+/*
+ * Call fun(magnitudes) with the magnitude distribution selected in
+ * the options.
+ */
+template<typename fun_t>
+void with_magnitudes(
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    const GenerationOptions& options,
+    fun_t&& fun
+)
+{
+    switch (options.magnitudes){
+        case Magnitudes::gutenberg_richter:
+            fun(GutenbergRichterMagnitudes(Mmin, Mmax, beta, alpha));
+            break;
+        case Magnitudes::tapered_gutenberg_richter:
+            fun(TaperedGutenbergRichterMagnitudes(
+                Mmin, Mmax, beta, alpha, options.corner_magnitude
+            ));
+            break;
+        case Magnitudes::table:
+            fun(MagnitudeTable(
+                Mmin, Mmax, alpha,
+                options.magnitude_table, options.magnitude_weights
+            ));
+            break;
+        default:
+            throw std::runtime_error("Unknown magnitude distribution.");
+    }
+}
+
+}
+
+#endif
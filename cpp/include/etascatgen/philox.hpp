@@ -0,0 +1,145 @@
+/*
+ * Counter-based random numbers from the Philox4x64-10 generator of
+ * Salmon et al. (2011).
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_PHILOX_HPP
+#define ETASCATGEN_PHILOX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace etascatgen {
+
+typedef std::array<uint64_t,4> philox_ctr_t;
+typedef std::array<uint64_t,2> philox_key_t;
+
+/*
+ * The Philox4x64-10 bijection: maps a 256 bit counter to 256 random
+ * bits, given a 128 bit key. The function is branch-free so that the
+ * compiler can vectorize loops over counters.
+ */
+inline philox_ctr_t philox4x64(philox_ctr_t ctr, philox_key_t key)
+{
+    constexpr uint64_t M0 = 0xD2E7470EE14C6C93;
+    constexpr uint64_t M1 = 0xCA5A826395121157;
+    constexpr uint64_t W0 = 0x9E3779B97F4A7C15;
+    constexpr uint64_t W1 = 0xBB67AE8584CAA73B;
+    for (int r=0; r<10; ++r){
+        if (r > 0){
+            key[0] += W0;
+            key[1] += W1;
+        }
+        const unsigned __int128 p0
+            = static_cast<unsigned __int128>(M0) * ctr[0];
+        const unsigned __int128 p1
+            = static_cast<unsigned __int128>(M1) * ctr[2];
+        ctr = {
+            static_cast<uint64_t>(p1 >> 64) ^ ctr[1] ^ key[0],
+            static_cast<uint64_t>(p1),
+            static_cast<uint64_t>(p0 >> 64) ^ ctr[3] ^ key[1],
+            static_cast<uint64_t>(p0)
+        };
+    }
+    return ctr;
+}
+
+
+/*
+ * Convert 64 random bits to a double in (0,1]. The result is never
+ * zero, so it can safely enter a logarithm.
+ */
+inline double uniform_0_1(uint64_t x)
+{
+    return static_cast<double>((x >> 11) + 1) * 0x1.0p-53;
+}
+
+
+/*
+ * Fill w with the 4 * n random words of the counters (c0, c1, c2, k0 + j)
+ * for j < n. The loop is branch-free, so that the compiler can
+ * vectorize it.
+ */
+inline void philox_fill(
+    philox_key_t key,
+    uint64_t c0,
+    uint64_t c1,
+    uint64_t c2,
+    uint64_t k0,
+    size_t n,
+    uint64_t* w
+)
+{
+    for (size_t j=0; j<n; ++j){
+        const philox_ctr_t x = philox4x64({c0, c1, c2, k0 + j}, key);
+        for (size_t l=0; l<4; ++l)
+            w[4*j + l] = x[l];
+    }
+}
+
+
+/*
+ * A stream of random numbers derived from a fixed key and the first
+ * three counter words. The fourth counter word enumerates the blocks
+ * of four random words. Satisfies the UniformRandomBitGenerator
+ * requirements, so that it can drive the standard distributions.
+ */
+class PhiloxStream {
+public:
+    typedef uint64_t result_type;
+
+    PhiloxStream(philox_key_t key, uint64_t c0, uint64_t c1, uint64_t c2,
+                 unsigned int skip = 0)
+        : key(key), ctr({c0, c1, c2, 0}), block(philox4x64(ctr, key)),
+          i(skip)
+    {}
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if (i == 4){
+            ++ctr[3];
+            block = philox4x64(ctr, key);
+            i = 0;
+        }
+        return block[i++];
+    }
+
+private:
+    philox_key_t key;
+    philox_ctr_t ctr;
+    philox_ctr_t block;
+    unsigned int i;
+};
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * A random number engine that can be fed by a producer thread.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_PIPELINE_HPP
+#define ETASCATGEN_PIPELINE_HPP
+
+#include <etascatgen/engine.hpp>
+#include <etascatgen/etascatgen.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+
+namespace etascatgen {
+
+/*
+ * Pipelined random numbers
+ * ========================
+ * The serial generators draw all random numbers of the triggering from
+ * one engine (see engine.hpp), which fills a block of BLOCK words at a
+ * time. With `pipelined`, a producer thread runs the engine instead and
+ * passes its words to the generator through a single-producer/
+ * single-consumer ring buffer, so that the engine runs concurrently with
+ * the event loop. The words arrive in the order of the engine, and each
+ * distribution consumes them as before, so that the catalog is
+ * identical to the one without the producer thread.
+ *
+ * The producer publishes the words in blocks by advancing `head`, and
+ * the consumer copies and releases them in the same blocks by advancing
+ * `tail`, so that each side touches the shared indices only once per
+ * block. A side that has to wait for the other blocks on the index
+ * (std::atomic::wait) rather than spinning, so that a producer that is
+ * ahead of its generator does not occupy a core. This matters for
+ * ensembles, whose members each run a producer next to the workers.
+ * The notification is cheap if nobody waits.
+ */
+class RandomPipeline {
+public:
+    typedef uint64_t result_type;
+
+    /*
+     * The external bit source `bits`, if set, replaces the engine. The
+     * engine remains for the forks (see `engine`).
+     */
+    RandomPipeline(
+        size_t seed,
+        Engine engine,
+        bool pipelined,
+        BitSource bits = BitSource()
+    ) : engine_(engine)
+    {
+        if (pipelined)
+            ring = std::make_unique<ring_t>(seed, engine, bits);
+        else
+            source.emplace(engine, seed, bits);
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if (i == BLOCK)
+            refill();
+        return block[i++];
+    }
+
+    /* The built-in engine, which the forks of a generator use: */
+    Engine engine() const
+    {
+        return engine_;
+    }
+
+    bool pipelined() const
+    {
+        return static_cast<bool>(ring);
+    }
+
+private:
+    static constexpr size_t BLOCK = 512;
+    static constexpr size_t CAPACITY = size_t(1) << 14;
+
+    struct ring_t {
+        std::array<uint64_t,CAPACITY> words;
+
+        /* The producer's side: */
+        alignas(64) std::atomic<size_t> head = 0;
+        std::atomic<bool> stop = false;
+
+        /* The consumer's side: */
+        alignas(64) std::atomic<size_t> tail = 0;
+
+        std::thread producer;
+
+        ring_t(size_t seed, Engine engine, BitSource bits)
+        {
+            producer = std::thread(
+                [this, seed, engine, bits](){ produce(seed, engine, bits); }
+            );
+        }
+
+        ~ring_t()
+        {
+            /*
+             * Release the whole ring, which the consumer no longer
+             * reads, to wake a producer that waits for space:
+             */
+            stop.store(true, std::memory_order_relaxed);
+            tail.fetch_add(CAPACITY, std::memory_order_release);
+            tail.notify_one();
+            producer.join();
+        }
+
+        void take(uint64_t* w)
+        {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            head.wait(t, std::memory_order_acquire);
+            std::copy_n(words.data() + t % CAPACITY, BLOCK, w);
+            tail.store(t + BLOCK, std::memory_order_release);
+            tail.notify_one();
+        }
+
+        void produce(size_t seed, Engine engine, BitSource bits)
+        {
+            RandomSource source(engine, seed, bits);
+            size_t h = 0;
+            while (!stop.load(std::memory_order_relaxed)){
+                const size_t t = tail.load(std::memory_order_acquire);
+                if (h + BLOCK - t > CAPACITY){
+                    tail.wait(t, std::memory_order_acquire);
+                    continue;
+                }
+                source.fill(words.data() + h % CAPACITY, BLOCK);
+                h += BLOCK;
+                head.store(h, std::memory_order_release);
+                head.notify_one();
+            }
+        }
+    };
+
+    Engine engine_;
+    std::optional<RandomSource> source;
+    std::unique_ptr<ring_t> ring;
+
+    /* The current block of words and the position within: */
+    std::array<uint64_t,BLOCK> block;
+    size_t i = BLOCK;
+
+    void refill()
+    {
+        if (ring)
+            ring->take(block.data());
+        else
+            source->fill(block.data(), BLOCK);
+        i = 0;
+    }
+};
+
+}
+
+#endif
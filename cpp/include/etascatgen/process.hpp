@@ -0,0 +1,189 @@
+/*
+ * ETAS process parameters and the analytic building blocks of the
+ * catalog generators.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_PROCESS_HPP
+#define ETASCATGEN_PROCESS_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/background.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace etascatgen {
+
+/*
+ * Parameters used in this implementation
+ * ======================================
+ *
+ * FK : Frequency `K / Tref^p` derived from K of Ogata (1988)
+ *      and a reference time scale Tref.
+ *      We use this instead of K itself to avoid fractional
+ *      units.
+ *
+ * kappa : Expected number of direct descendants of an event per unit
+ *         f(M). Hence, an event of magnitude M has kappa * f(M) direct
+ *         descendants on average, and kappa * <f(M)> is the offspring
+ *         fraction (the branching ratio). The mean <f(M)> over the
+ *         magnitude distribution is passed to the constructor (see
+ *         magnitude.hpp).
+ */
+
+struct Process_M_t {
+    Frequency mu_0;
+    Time Tref;
+    Time c;
+    double beta;
+    double alpha;
+    double Mmin;
+    double Mmax;
+    double p;
+    double ln_p;
+    double offspring_fraction;
+    double kappa;
+    Frequency FK;
+    BackgroundRate background;
+
+    Process_M_t(
+        Frequency mu_0,
+        Time Tref,
+        Time c,
+        double beta,
+        double alpha,
+        double p,
+        double Mmin,
+        double Mmax,
+        double offspring_fraction,
+        double mean_f,
+        BackgroundRate background
+    ) : mu_0(mu_0), Tref(Tref), c(c), beta(beta), alpha(alpha),
+        Mmin(Mmin), Mmax(Mmax), p(p), ln_p(std::log(p)),
+        offspring_fraction(offspring_fraction),
+        kappa(offspring_fraction / mean_f),
+        FK(
+            /*
+             * The modified Omori kernel integrates to
+             *    K * c ** (1-p) / (p-1)
+             *    = FK * Tref * (c / Tref) ** (1-p) / (p-1)
+             */
+            kappa * (p - 1.0) / (Tref * std::pow(c / Tref, 1.0 - p))
+        ),
+        background(std::move(background))
+    {}
+};
+
+
+/*
+ * Productivity of an event of magnitude M:
+ */
+inline double f(double M, const Process_M_t& process)
+{
+    return std::exp(process.alpha * (M - process.Mmin));
+}
+
+
+/*
+ * Expected number of direct descendants of an event of productivity
+ * f_M = f(M):
+ */
+inline double expected_offspring(
+    double f_M,
+    const Process_M_t& process
+)
+{
+    return process.kappa * f_M;
+}
+
+
+/*
+ * Transformed clock
+ * =================
+ * In the transformed time
+ *    sigma = S(t - ti),
+ * where S is the survival function of the normalized triggering
+ * kernel (see kernel.hpp), which decreases from 1 at t = ti to 0 at
+ * t -> oo, the expected number of descendants of parent i within
+ * [t0, t1] is Lambda * (sigma(t0) - sigma(t1)). Lambda is the total
+ * expected number of descendants of the parent. That is, the
+ * descendants form a homogeneous Poisson process of rate Lambda in
+ * sigma, and the next descendant follows from the current sigma by
+ * subtracting an exponential variate E divided by Lambda. There is no
+ * further descendant if sigma drops below zero.
+ * In particular, a new event has no descendants at all if
+ *    E >= Lambda,
+ * which requires only its magnitude.
+ */
+inline double advance_clock(
+    double E,
+    double sigma,
+    double Lambda_inv
+)
+{
+    return sigma - E * Lambda_inv;
+}
+
+
+/*
+ * The next background event after tl, given a uniform q in (0,1]
+ * (see background.hpp):
+ */
+inline Time next_background_occurrence(
+    double q,
+    Time tl,
+    const Process_M_t& process
+)
+{
+    return process.background.next(q, tl);
+}
+
+
+/*
+ * The n background events t[0..n) following tl, given n unit
+ * exponentials E:
+ */
+inline void next_background_occurrences(
+    const double* E,
+    size_t n,
+    Time tl,
+    Time* t,
+    const Process_M_t& process
+)
+{
+    process.background.next(E, n, tl, t);
+}
+
+
+inline double draw_magnitude(
+    double q,
+    double Mmin,
+    double Mmax,
+    double beta
+)
+{
+    return Mmin - std::log(
+            1.0 - q * (1.0 - std::exp(-beta * (Mmax - Mmin)))
+    ) / beta;
+}
+
+}
+
+#endif
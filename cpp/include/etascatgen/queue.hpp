@@ -0,0 +1,252 @@
+/*
+ * Priority queues of the intensity components, keyed by the time of
+ * their next occurrence.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_QUEUE_HPP
+#define ETASCATGEN_QUEUE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * All queues provide the interface of std::priority_queue
+ * (empty, size, top, push, pop) and return the element with the
+ * smallest `tnext` member first.
+ */
+
+
+/*
+ * Replace the top element of the queue by x, which has to be
+ * ordered after the top element. Uses the single pass of the
+ * queue's own `replace_top` if available.
+ */
+template<typename queue_t, typename T>
+void replace_top(queue_t& queue, const T& x)
+{
+    if constexpr (requires { queue.replace_top(x); }){
+        queue.replace_top(x);
+    } else {
+        queue.pop();
+        queue.push(x);
+    }
+}
+
+
+/*
+ * An implicit D-ary min-heap. With D=4, the children of a node
+ * share a cache line, which halves the depth of the heap compared
+ * to the binary heap at the cost of more comparisons per level.
+ */
+template<typename T, unsigned int D=4>
+class DaryHeap {
+public:
+    bool empty() const
+    {
+        return heap.empty();
+    }
+
+    size_t size() const
+    {
+        return heap.size();
+    }
+
+    const T& top() const
+    {
+        return heap.front();
+    }
+
+    void push(const T& x)
+    {
+        size_t i = heap.size();
+        heap.push_back(x);
+        while (i > 0){
+            const size_t parent = (i - 1) / D;
+            if (!(x.tnext < heap[parent].tnext))
+                break;
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i] = x;
+    }
+
+    void pop()
+    {
+        const T last = heap.back();
+        heap.pop_back();
+        if (!heap.empty())
+            sift_down(last);
+    }
+
+    /*
+     * Replace the top element by x. Equivalent to pop() followed by
+     * push(x), but with a single pass down the heap.
+     */
+    void replace_top(const T& x)
+    {
+        sift_down(x);
+    }
+
+private:
+    std::vector<T> heap;
+
+    void sift_down(const T& x)
+    {
+        const size_t n = heap.size();
+        size_t i = 0;
+        while (true){
+            const size_t c0 = D * i + 1;
+            if (c0 >= n)
+                break;
+            const size_t c1 = (c0 + D < n) ? c0 + D : n;
+            size_t cmin = c0;
+            for (size_t c=c0+1; c<c1; ++c)
+                if (heap[c].tnext < heap[cmin].tnext)
+                    cmin = c;
+            if (!(heap[cmin].tnext < x.tnext))
+                break;
+            heap[i] = heap[cmin];
+            i = cmin;
+        }
+        heap[i] = x;
+    }
+};
+
+
+/*
+ * A radix heap on the IEEE 754 bit pattern of `tnext`.
+ *
+ * For non-negative doubles, the order of the bit patterns (read as
+ * unsigned integers) is the order of the numbers. Since the
+ * occurrence times are non-negative and every pushed element lies
+ * after the last popped one, the queue is monotone and the radix
+ * heap applies: An element is stored in the bucket given by the
+ * highest bit in which its key differs from the last popped key.
+ * Each element moves to a lower bucket at most 64 times, and pushing
+ * is a single append.
+ */
+template<typename T>
+class RadixHeap {
+public:
+    bool empty() const
+    {
+        return n == 0;
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    const T& top()
+    {
+        if (!buckets[0].empty())
+            return buckets[0].back();
+        if (!cached)
+            find_min();
+        return buckets[cache_bucket][cache_index];
+    }
+
+    void push(const T& x)
+    {
+        const uint64_t k = key(x);
+        const unsigned int b = bucket(k);
+        buckets[b].push_back(x);
+        ++n;
+        if (b > 0 && cached && (b < cache_bucket
+            || (b == cache_bucket
+                && k < key(buckets[cache_bucket][cache_index]))))
+        {
+            cache_bucket = b;
+            cache_index = buckets[b].size() - 1;
+        }
+    }
+
+    void pop()
+    {
+        --n;
+        if (!buckets[0].empty()){
+            buckets[0].pop_back();
+            return;
+        }
+        if (!cached)
+            find_min();
+
+        /*
+         * Remove the minimum and redistribute the remainder of its
+         * bucket relative to the new last key:
+         */
+        std::vector<T>& b = buckets[cache_bucket];
+        last = key(b[cache_index]);
+        b[cache_index] = b.back();
+        b.pop_back();
+        for (const T& x : b)
+            buckets[bucket(key(x))].push_back(x);
+        b.clear();
+        cached = false;
+    }
+
+private:
+    std::array<std::vector<T>,65> buckets;
+    uint64_t last = 0;
+    size_t n = 0;
+
+    /* Cached location of the minimum if bucket 0 is empty: */
+    bool cached = false;
+    unsigned int cache_bucket = 0;
+    size_t cache_index = 0;
+
+    static uint64_t key(const T& x)
+    {
+        return std::bit_cast<uint64_t>(static_cast<double>(x.tnext.value()));
+    }
+
+    unsigned int bucket(uint64_t k) const
+    {
+        return (k == last) ? 0 : 64 - std::countl_zero(k ^ last);
+    }
+
+    void find_min()
+    {
+        unsigned int b = 1;
+        while (buckets[b].empty())
+            ++b;
+        size_t imin = 0;
+        uint64_t kmin = key(buckets[b][0]);
+        for (size_t i=1; i<buckets[b].size(); ++i){
+            const uint64_t k = key(buckets[b][i]);
+            if (k < kmin){
+                kmin = k;
+                imin = i;
+            }
+        }
+        cache_bucket = b;
+        cache_index = imin;
+        cached = true;
+    }
+};
+
+}
+
+#endif
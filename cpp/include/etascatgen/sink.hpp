@@ -0,0 +1,307 @@
+/*
+ * Output sinks of the catalog generators.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_SINK_HPP
+#define ETASCATGEN_SINK_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/arena.hpp>
+#include <etascatgen/process.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace etascatgen {
+
+/*
+ * Output sinks
+ * ============
+ * The generators pass the events in time order to a sink, which
+ * decides which of them to store and when the generation is complete:
+ *   - done():       Whether the generation is complete.
+ *   - push(t, M):   Pass the next event.
+ *   - skips(n, t):  Whether the next n events, which all occur before
+ *                   t, would all be discarded. The generators can then
+ *                   pass them to skip(n) without ordering them.
+ *   - skip(n):      Discard n events.
+ * Sinks may additionally provide
+ *   - observe(background, queue_size):
+ *                   Called by the sequential method before each push
+ *                   with whether the event is a background event and
+ *                   the number of active parents.
+ */
+
+
+/*
+ * Discard the first N_skip events and store the following ones in the
+ * preallocated arrays until they are full.
+ */
+class CountSink {
+public:
+    typedef decltype(
+        std::declval<cyantities::QuantityWrapper&>().iter<Scalar>()
+    ) M_range_t;
+    typedef decltype(std::declval<M_range_t&>().begin()) M_iter_t;
+    typedef decltype(
+        std::declval<cyantities::QuantityWrapper&>().iter<Time>()
+    ) t_range_t;
+    typedef decltype(std::declval<t_range_t&>().begin()) t_iter_t;
+
+    CountSink(
+        size_t N_skip,
+        cyantities::QuantityWrapper& Mi,
+        cyantities::QuantityWrapper& ti
+    ) : N_skip(N_skip), N_end(N_skip + Mi.size()),
+        M_out(Mi.iter<Scalar>()), M_out_i(M_out.begin()),
+        t_out(ti.iter<Time>()), t_out_i(t_out.begin())
+    {}
+
+    /*
+     * Store N events from the iterators M_out_i and t_out_i on, which
+     * point into the ranges M_out and t_out:
+     */
+    CountSink(
+        size_t N_skip,
+        size_t N,
+        const M_range_t& M_out,
+        M_iter_t M_out_i,
+        const t_range_t& t_out,
+        t_iter_t t_out_i
+    ) : N_skip(N_skip), N_end(N_skip + N),
+        M_out(M_out), M_out_i(M_out_i), t_out(t_out), t_out_i(t_out_i)
+    {}
+
+    bool done() const
+    {
+        return n >= N_end;
+    }
+
+    void push(Time t, double M)
+    {
+        if (n >= N_skip){
+            *t_out_i = t;
+            *M_out_i = M;
+            ++t_out_i;
+            ++M_out_i;
+        }
+        ++n;
+    }
+
+    bool skips(size_t k, Time) const
+    {
+        return n + k <= N_skip;
+    }
+
+    void skip(size_t k)
+    {
+        n += k;
+    }
+
+private:
+    size_t n = 0;
+    size_t N_skip;
+    size_t N_end;
+    M_range_t M_out;
+    M_iter_t M_out_i;
+    t_range_t t_out;
+    t_iter_t t_out_i;
+};
+
+
+/*
+ * Discard the events of an automatically determined burn-in, at most
+ * N_skip_max, and store the following ones in the preallocated arrays
+ * until they are full.
+ * The burn-in is monitored in windows of events, the first of
+ * options.burn_in_window events and each following one twice as long
+ * as its predecessor. The burn-in ends after two consecutive windows
+ * in which
+ *  - the number of events relative to its stationary expectation,
+ *    the expected number of background events divided by (1 - n),
+ *    deviates from one by less than the tolerance, and
+ *  - the fraction of triggered events deviates from the branching
+ *    ratio n by less than the tolerance.
+ * Requiring two windows guards against a single window that matches
+ * by chance, which is common for short windows given the clustering.
+ * The fraction of triggered events and the number of active parents
+ * require the sequential method (`observe`) and are skipped otherwise.
+ * The number of active parents is reported but not tested: for Omori
+ * kernels with their heavy tail, it grows without bound. The statistics
+ * of the last window are reported to the GenerationInfo.
+ */
+class AutoCountSink {
+public:
+    AutoCountSink(
+        size_t N_skip_max,
+        const Process_M_t& process,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        cyantities::QuantityWrapper& Mi,
+        cyantities::QuantityWrapper& ti
+    ) : N_skip_max(N_skip_max), process(process),
+        tolerance(options.burn_in_tolerance),
+        window(std::max<size_t>(options.burn_in_window, 1)), info(info),
+        N(Mi.size()),
+        M_out(Mi.iter<Scalar>()), M_out_i(M_out.begin()),
+        t_out(ti.iter<Time>()), t_out_i(t_out.begin())
+    {
+        info.burn_in_events = 0;
+        info.burn_in_converged = false;
+        if (N_skip_max == 0)
+            burning_in = false;
+    }
+
+    bool done() const
+    {
+        return n_out >= N;
+    }
+
+    void observe(bool background, size_t queue_size)
+    {
+        observed = true;
+        w_bg += background;
+        queue = queue_size;
+    }
+
+    void push(Time t, double M)
+    {
+        if (burning_in){
+            burn_in(t);
+            return;
+        }
+        *t_out_i = t;
+        *M_out_i = M;
+        ++t_out_i;
+        ++M_out_i;
+        ++n_out;
+    }
+
+    bool skips(size_t, Time) const
+    {
+        return false;
+    }
+
+    void skip(size_t)
+    {}
+
+private:
+    size_t N_skip_max;
+    const Process_M_t& process;
+    double tolerance;
+    size_t window;
+    GenerationInfo& info;
+    bool burning_in = true;
+    bool observed = false;
+    bool passed = false;
+
+    /* Current window: */
+    Time w_t0 = 0.0 * bu::si::seconds;
+    size_t w_n = 0;
+    size_t w_bg = 0;
+    size_t queue = 0;
+
+    /* Output: */
+    size_t N;
+    size_t n_out = 0;
+    decltype(std::declval<cyantities::QuantityWrapper&>().iter<Scalar>())
+        M_out;
+    decltype(M_out.begin()) M_out_i;
+    decltype(std::declval<cyantities::QuantityWrapper&>().iter<Time>())
+        t_out;
+    decltype(t_out.begin()) t_out_i;
+
+    void burn_in(Time t)
+    {
+        ++info.burn_in_events;
+        ++w_n;
+        if (w_n == window){
+            const double n = process.offspring_fraction;
+            const double expected
+                = process.background.expected(w_t0, t) / (1.0 - n);
+            info.burn_in_rate_ratio = w_n / expected;
+            bool pass = std::abs(info.burn_in_rate_ratio - 1.0) < tolerance;
+            if (observed){
+                info.burn_in_branching
+                    = 1.0 - static_cast<double>(w_bg) / w_n;
+                info.burn_in_queue_size = queue;
+                pass = pass
+                    && std::abs(info.burn_in_branching - n) < tolerance;
+            }
+            info.burn_in_converged = pass && passed;
+            passed = pass;
+            if (info.burn_in_converged)
+                burning_in = false;
+
+            /* Next window: */
+            w_t0 = t;
+            w_n = 0;
+            w_bg = 0;
+            window *= 2;
+        }
+        if (info.burn_in_events >= N_skip_max)
+            burning_in = false;
+    }
+};
+
+
+/*
+ * Discard the events before T0 and store the events in [T0, T1) in a
+ * catalog arena. The generation ends with the first event at or after
+ * T1.
+ */
+class WindowSink {
+public:
+    WindowSink(Time T0, Time T1, CatalogArena& catalog)
+       : T0(T0), T1(T1), catalog(catalog)
+    {}
+
+    bool done() const
+    {
+        return complete;
+    }
+
+    void push(Time t, double M)
+    {
+        if (t >= T1)
+            complete = true;
+        else if (t >= T0)
+            catalog.push(t.value(), M);
+    }
+
+    bool skips(size_t, Time t) const
+    {
+        return t <= T0;
+    }
+
+    void skip(size_t)
+    {}
+
+private:
+    Time T0;
+    Time T1;
+    CatalogArena& catalog;
+    bool complete = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Sum-of-exponentials approximation of the modified Omori kernel and
+ * the Markovian catalog generator built upon it.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_SUMEXP_HPP
+#define ETASCATGEN_SUMEXP_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/process.hpp>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Approximation
+ *    (1 + x) ** (-p)  ~=  sum_j  w[j] * exp(-lambda[j] * x)
+ * for 0 <= x <= horizon, where x = t / c is the time in units of c.
+ */
+struct ExponentialSum {
+    std::vector<double> w;
+    std::vector<double> lambda;
+
+    /* Maximum relative error of the approximation on [0, horizon]: */
+    double error;
+};
+
+
+/*
+ * Fit the sum of exponentials to the relative tolerance `rtol` on
+ * [0, horizon]. The fit discretizes the Laplace representation
+ *    (1 + x) ** (-p) = 1/Gamma(p) * int_0^oo l**(p-1) exp(-l(1+x)) dl
+ * by the trapezoidal rule in log(l), and refines the discretization
+ * until the error measured on a dense grid drops below rtol. Throws
+ * if the refinement does not reach rtol.
+ */
+ExponentialSum fit_exponential_sum(double p, double horizon, double rtol);
+
+
+/*
+ * Generate the catalog from the Hawkes process whose Omori kernel is
+ * replaced by the sum of exponentials. This process is Markovian in
+ * the decaying intensity of each exponential term, so that the state
+ * of the generator does not grow with the number of active parents.
+ * The events are passed to the sink (see sink.hpp).
+ * Instantiated for the magnitude distributions of magnitude.hpp and
+ * the sinks of sink.hpp.
+ */
+template<typename magnitudes_t, typename sink_t>
+void generate_exponential_sum(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    sink_t& sink
+);
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ * Aggregation of old parents into super-parents.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_SUPERPARENT_HPP
+#define ETASCATGEN_SUPERPARENT_HPP
+
+#include <etascatgen/etascatgen.hpp>
+#include <etascatgen/exponential.hpp>
+#include <etascatgen/process.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Super-parents
+ * =============
+ * For Omori kernels with p close to one, a parent keeps producing
+ * descendants for a very long time, so that the samplers hold millions
+ * of old parents, each of which contributes little. Once a parent
+ * reaches the age A, its further descendants are instead produced by
+ * a super-parent: a single intensity component
+ *    W * g(t - tB)
+ * that stands for all parents with occurrence times close to tB.
+ *
+ * The super-parents are ordered by tB. A parent at ti joins the
+ * nearest super-parent if
+ *    |ti - tB| <= width * (t - max(ti, tB)),
+ * that is, if the two are close relative to their age at the current
+ * time t, and otherwise becomes a super-parent of its own. Adjacent
+ * super-parents that satisfy the same criterion are merged whenever
+ * their number has doubled since the last merger (merging later only
+ * reduces the error), so that their number grows only logarithmically
+ * with the length of the catalog at amortized constant cost.
+ * A merger places the super-parent at the W-weighted mean time, which
+ * cancels the first-order error of the combined intensity, and sets W
+ * so that the expected number of descendants after t is preserved.
+ * The remaining relative error of the intensity is of second order,
+ *    ~ p * (p + 1) / 8 * width**2
+ * for the Omori kernel.
+ *
+ * The future descendants of a super-parent form a Poisson process on
+ * its transformed clock, as for a single parent (see ClockSampler).
+ * They are not part of the priority queue, since each merger redraws
+ * the next descendant of the super-parent from t. This discards a draw
+ * beyond t, which is valid since the decision to merge does not depend
+ * on it. For the same reason, a super-parent is kept even if its draw
+ * yields no further descendant (a later merger redraws it), and it is
+ * only removed once its kernel has vanished. The next occurrence among
+ * the super-parents is tracked separately.
+ *
+ * W is in units of the kernel's clock, that is, it counts the
+ * candidates of thinned kernels, which are accepted relative to the
+ * super-parent's time.
+ */
+template<typename kernel_t>
+class SuperParents {
+public:
+    inline static const Time NEVER
+        = std::numeric_limits<double>::infinity() * bu::si::seconds;
+
+    /*
+     * An age of zero disables the super-parents:
+     */
+    SuperParents(const kernel_t& kernel, Time age, double width)
+       : kernel(kernel), A(age > 0.0 * bu::si::seconds ? age : NEVER),
+         width(width),
+         sigma_A(age > 0.0 * bu::si::seconds ? kernel.survival(age) : 0.0)
+    {}
+
+    /* The age at which parents join the super-parents: */
+    Time age() const
+    {
+        return A;
+    }
+
+    /*
+     * The transformed clock of a parent at the age A. A parent whose
+     * next descendant falls below it has no further descendants before
+     * the age A:
+     */
+    double clock() const
+    {
+        return sigma_A;
+    }
+
+    /*
+     * Whether a parent whose next descendant falls at the clock sigma
+     * (zero if it has none) joins the super-parents:
+     */
+    bool joins(double sigma) const
+    {
+        return sigma < sigma_A;
+    }
+
+    /* The next descendant of the super-parents: */
+    Time next() const
+    {
+        return t_min;
+    }
+
+    /*
+     * Add the parent at ti with W expected descendants in total, of
+     * which w are expected after t:
+     */
+    template<typename rng_t>
+    void add(Time t, Time ti, double W, double w, rng_t& rng)
+    {
+        ++n_joined;
+        if (!(w > 0.0))
+            return;
+        const size_t j = std::upper_bound(
+            buckets.cbegin(), buckets.cend(), ti,
+            [](Time t_, const bucket_t& b){ return t_ < b.t; }
+        ) - buckets.cbegin();
+
+        /*
+         * Join the nearer neighbour if close enough:
+         */
+        size_t k = j;
+        if (j > 0 && (j == buckets.size()
+                      || ti - buckets[j-1].t < buckets[j].t - ti))
+            k = j-1;
+        if (k < buckets.size() && close(buckets[k].t, ti, t)){
+            combine(buckets[k], t, ti, W, w);
+            redraw(k, t, rng);
+            return;
+        }
+
+        /*
+         * New super-parent:
+         */
+        buckets.insert(buckets.begin() + j, bucket_t(ti, W, w / W, NEVER));
+        if (i_min >= j)
+            ++i_min;
+        n_peak = std::max(n_peak, buckets.size());
+        redraw(j, t, rng);
+
+        /*
+         * Coarsening, once the number of super-parents has doubled:
+         */
+        if (buckets.size() >= 2 * n_coarse){
+            coarsen(t, rng);
+            n_coarse = std::max<size_t>(buckets.size(), 8);
+            rescan();
+        }
+    }
+
+    /*
+     * Advance the super-parent whose descendant at next() occurred:
+     */
+    template<typename rng_t>
+    void fire(rng_t& rng)
+    {
+        bucket_t& b = buckets[i_min];
+        draw(b, b.tnext, rng);
+        rescan();
+    }
+
+    void clear()
+    {
+        buckets.clear();
+        t_min = NEVER;
+        n_coarse = 8;
+    }
+
+    /* Number of parents that joined, and peak number of super-parents: */
+    size_t joined() const
+    {
+        return n_joined;
+    }
+
+    size_t peak() const
+    {
+        return n_peak;
+    }
+
+private:
+    static constexpr bool thinned = requires(const kernel_t& k, Time dt)
+    {
+        k.acceptance(dt);
+    };
+
+    struct bucket_t {
+        /* Time and total expected number of descendants: */
+        Time t;
+        double W;
+
+        /* Transformed clock at the last draw, and the next descendant: */
+        double s;
+        Time tnext;
+    };
+
+    const kernel_t kernel;
+    Time A;
+    double width;
+    double sigma_A;
+
+    std::vector<bucket_t> buckets;
+    size_t i_min = 0;
+    Time t_min = NEVER;
+
+    /* Number of super-parents after the last coarsening: */
+    size_t n_coarse = 8;
+
+    size_t n_joined = 0;
+    size_t n_peak = 0;
+
+    bool close(Time ta, Time tb, Time t) const
+    {
+        const Time dt = (ta > tb) ? ta - tb : tb - ta;
+        return dt <= width * (t - std::max(ta, tb));
+    }
+
+    /*
+     * Merge the component at ti of W expected descendants, w of which
+     * are expected after t, into b:
+     */
+    void combine(bucket_t& b, Time t, Time ti, double W, double w) const
+    {
+        const double w_b = b.W * kernel.survival(t - b.t);
+        b.t = (b.W * b.t + W * ti) / (b.W + W);
+        b.s = kernel.survival(t - b.t);
+        b.W = (b.s > 0.0) ? (w_b + w) / b.s : 0.0;
+    }
+
+    /*
+     * Draw the next descendant after the clock b.s, at or after t:
+     */
+    template<typename rng_t>
+    void draw(bucket_t& b, Time t, rng_t& rng)
+    {
+        while (true){
+            const double sigma = advance_clock(
+                exponential(rng), b.s, 1.0 / b.W
+            );
+            if (!(sigma > 0.0)){
+                b.tnext = NEVER;
+                return;
+            }
+            b.s = sigma;
+            const Time delay = kernel.inverse_survival(sigma);
+            if constexpr (thinned){
+                if (uniform_0_1(rng()) >= kernel.acceptance(delay))
+                    continue;
+            }
+            b.tnext = std::max(t, b.t + delay);
+            return;
+        }
+    }
+
+    /*
+     * Redraw super-parent k after a merger at t:
+     */
+    template<typename rng_t>
+    void redraw(size_t k, Time t, rng_t& rng)
+    {
+        draw(buckets[k], t, rng);
+        if (buckets[k].tnext < t_min){
+            i_min = k;
+            t_min = buckets[k].tnext;
+        } else if (k == i_min){
+            rescan();
+        }
+    }
+
+    /*
+     * Remove the super-parents whose kernel has vanished (the oldest
+     * ones), and merge adjacent super-parents that have become close:
+     */
+    template<typename rng_t>
+    void coarsen(Time t, rng_t& rng)
+    {
+        size_t n = 0;
+        while (n < buckets.size()
+               && !(kernel.survival(t - buckets[n].t) > 0.0))
+            ++n;
+        buckets.erase(buckets.begin(), buckets.begin() + n);
+        size_t k = 0;
+        while (k+1 < buckets.size()){
+            bucket_t& a = buckets[k];
+            const bucket_t& b = buckets[k+1];
+            if (!close(a.t, b.t, t)){
+                ++k;
+                continue;
+            }
+            combine(a, t, b.t, b.W, b.W * kernel.survival(t - b.t));
+            buckets.erase(buckets.begin() + k + 1);
+            draw(buckets[k], t, rng);
+        }
+    }
+
+    void rescan()
+    {
+        t_min = NEVER;
+        for (size_t k=0; k<buckets.size(); ++k){
+            if (buckets[k].tnext < t_min){
+                i_min = k;
+                t_min = buckets[k].tnext;
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * A minimal thread pool for the parallel catalog generators.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#ifndef ETASCATGEN_THREADPOOL_HPP
+#define ETASCATGEN_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace etascatgen {
+
+/*
+ * Resolve the requested number of threads (0 meaning 'all cores'):
+ */
+inline unsigned int resolve_thread_count(unsigned int threads)
+{
+    if (threads == 0){
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+    }
+    return threads;
+}
+
+
+/*
+ * A pool of persistent worker threads. The calling thread takes part
+ * in the work as worker 0, so that a pool of size 1 does not spawn
+ * any thread at all.
+ * Tasks are handed out dynamically from an atomic counter, so that
+ * tasks of varying cost are balanced across the workers.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threads)
+    {
+        threads = resolve_thread_count(threads);
+        workers.reserve(threads - 1);
+        for (unsigned int i=1; i<threads; ++i)
+            workers.emplace_back([this, i](){ work(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        start_cv.notify_all();
+        for (std::thread& w : workers)
+            w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const
+    {
+        return workers.size() + 1;
+    }
+
+    /*
+     * Call fn(task, worker) for all tasks in [0, n_tasks) and return
+     * once all tasks have finished. The first exception thrown by
+     * any task is rethrown in the calling thread.
+     */
+    void parallel_for(
+        size_t n_tasks,
+        std::function<void(size_t, unsigned int)> fn
+    )
+    {
+        if (workers.empty() || n_tasks <= 1){
+            for (size_t i=0; i<n_tasks; ++i)
+                fn(i, 0);
+            return;
+        }
+        {
+            std::lock_guard lock(mutex);
+            job = std::move(fn);
+            next_task = 0;
+            this->n_tasks = n_tasks;
+            running = workers.size();
+            error = nullptr;
+            ++generation;
+        }
+        start_cv.notify_all();
+        run_tasks(0);
+        {
+            std::unique_lock lock(mutex);
+            done_cv.wait(lock, [this](){ return running == 0; });
+            job = nullptr;
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    std::function<void(size_t, unsigned int)> job;
+    std::atomic<size_t> next_task = 0;
+    size_t n_tasks = 0;
+    size_t running = 0;
+    size_t generation = 0;
+    bool stop = false;
+    std::exception_ptr error;
+
+    void run_tasks(unsigned int worker)
+    {
+        size_t i;
+        while ((i = next_task.fetch_add(1)) < n_tasks){
+            try {
+                job(i, worker);
+            } catch (...) {
+                std::lock_guard lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+
+    void work(unsigned int worker)
+    {
+        size_t seen = 0;
+        while (true){
+            {
+                std::unique_lock lock(mutex);
+                start_cv.wait(lock, [this, seen](){
+                    return stop || generation != seen;
+                });
+                if (stop)
+                    return;
+                seen = generation;
+            }
+            run_tasks(worker);
+            {
+                std::lock_guard lock(mutex);
+                if (--running == 0)
+                    done_cv.notify_one();
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -20,11 +20,31 @@
  */
 
 #include <etascatgen/etascatgen.hpp>
+#include <etascatgen/process.hpp>
+#include <etascatgen/cluster.hpp>
+#include <etascatgen/exponential.hpp>
+#include <etascatgen/eventstream.hpp>
+#include <etascatgen/kernel.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <etascatgen/pipeline.hpp>
+#include <etascatgen/queue.hpp>
+#include <etascatgen/sink.hpp>
+#include <etascatgen/sumexp.hpp>
+#include <etascatgen/superparent.hpp>
+#include <etascatgen/threadpool.hpp>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <ranges>
 #include <numeric>
 #include <random>
 #include <optional>
+#include <memory>
+#include <mutex>
+#include <array>
 #include <queue>
+#include <string>
+#include <type_traits>
 #include <boost/math/quadrature/gauss.hpp>
 #include <boost/math/tools/roots.hpp>
 
@@ -34,223 +54,1266 @@
 namespace etascatgen {
 
 /*
- * Parameters used in this implementation
- * ======================================
+ * The intensity components of the Hawkes process are split into two
+ * parts: The priority queue holds only the time of the next occurrence
+ * and the index of the parent event in the parent table. The parent
+ * table holds, as a structure of arrays, the attributes of the parents
+ * that are needed to draw their next occurrence.
+ */
+struct descendant_t {
+    Time tnext;
+    uint32_t parent;
+
+    /*
+     * Ordering for a priority queue that provides the
+     * next event:
+     */
+    bool operator>(const descendant_t& other) const
+    {
+        return tnext < other.tnext;
+    }
+
+    bool operator<(const descendant_t& other) const
+    {
+        return tnext > other.tnext;
+    }
+};
+
+
+/*
+ * Samplers of the descendants of the parents
+ * ==========================================
+ * A sampler keeps the parents of future descendants in a table (as
+ * a structure of arrays) whose slots are recycled once a parent has
+ * no further descendants. It provides
+ *   - first(t, f, rng): Register the new event at t with productivity
+ *                       f = f(M) as a parent and return its first
+ *                       descendant (if any).
+ *   - next(i, t, rng):  Return the descendant of parent i that follows
+ *                       the descendant at t (if any). If there is none,
+ *                       the parent's slot is released.
+ *
+ * If the tolerance is positive, a parent is retired once its expected
+ * number of further descendants falls below the tolerance. On the
+ * transformed clock sigma = S(t - ti), this is the threshold
+ *    sigma_r = tolerance / Lambda,
+ * and the parent is retired as soon as its next drawn descendant falls
+ * below sigma_r, instead of waiting in the queue for it. This discards
+ * the descendants below sigma_r, a Poisson number of mean `tolerance`
+ * per parent. Given the drawn descendant at sigma, the discarded
+ * number is one plus a Poisson number of mean Lambda * sigma (the
+ * CountSampler knows it exactly), which the samplers tally (see
+ * `retire`).
  *
- * FK : Frequency `K / Tref^p` derived from K of Ogata (1988)
- *      and a reference time scale Tref.
- *      We use this instead of K itself to avoid fractional
- *      units.
+ * If super-parents are enabled (see superparent.hpp), a parent whose
+ * next descendant falls below the clock S(A) of the age A, or that has
+ * none, has no further descendants before that age. Its queue entry is
+ * replaced by one at its age A (`joining`), at which the parent hands
+ * over to the super-parents with its remaining Lambda * S(A) expected
+ * descendants (`join`). Since this decision depends only on the
+ * absence of descendants before the age A, which are independent of
+ * those after, the drawn descendant can be discarded. Every parent
+ * joins in this way, so that the parent table holds only parents
+ * younger than A. Past parents older than A join right away.
  */
 
-struct Process_M_t {
-    Frequency mu_0;
-    Time Tref;
-    Time c;
-    double beta;
-    double alpha;
-    double Mmin;
-    double p;
-    double ln_p;
-    Frequency FK;
-
-    Process_M_t(
-        Frequency mu_0,
-        Time Tref,
-        Time c,
-        double beta,
-        double alpha,
-        double p,
-        double Mmin,
-        double Mmax,
-        double offspring_fraction
-    ) : mu_0(mu_0), Tref(Tref), c(c), beta(beta), alpha(alpha),
-        Mmin(Mmin), p(p), ln_p(std::log(p)),
-        FK(
-            critical_FK(Mmin, Mmax, p, c, Tref, beta, alpha)
-            * offspring_fraction
-        )
+/*
+ * Draws the descendants one by one on the transformed clock.
+ * For kernels that are sampled by thinning, the clock runs on the
+ * envelope of the kernel, and each candidate is accepted with the
+ * kernel's acceptance probability.
+ */
+template<typename kernel_t>
+class ClockSampler {
+public:
+    ClockSampler(
+        const Process_M_t& process,
+        const kernel_t& kernel,
+        const GenerationOptions& options
+    ) : process(process), kernel(kernel),
+        tolerance(options.retire_tolerance),
+        super(kernel, options.aggregate_age * process.c,
+              options.aggregate_width)
     {}
 
+    template<typename rng_t>
+    std::optional<descendant_t> first(Time t, double f_M, rng_t& rng)
+    {
+        /*
+         * The test whether the event has any descendants at all
+         * requires only its magnitude:
+         */
+        double Lambda = expected_offspring(f_M, process);
+        if constexpr (thinned)
+            Lambda *= kernel.envelope_factor;
+        const double E = exponential(rng);
+        const double Lambda_inv = 1.0 / Lambda;
+        const double sigma
+            = (E < Lambda) ? advance_clock(E, 1.0, Lambda_inv) : 0.0;
+        if (super.joins(sigma)){
+            const uint32_t i = insert(t, -super.clock(), Lambda_inv);
+            return descendant_t(t + super.age(), i);
+        }
+        if (E >= Lambda)
+            return std::optional<descendant_t>();
+        if (sigma < tolerance * Lambda_inv){
+            retire(1.0 + sigma * Lambda);
+            return std::optional<descendant_t>();
+        }
+        const uint32_t i = insert(t, sigma, Lambda_inv);
+        const Time delay = kernel.inverse_survival(sigma);
+        if constexpr (thinned){
+            if (uniform_0_1(rng()) >= kernel.acceptance(delay)){
+                std::optional<Time> tnext(next(i, t, rng));
+                if (!tnext)
+                    return std::optional<descendant_t>();
+                return descendant_t(*tnext, i);
+            }
+        }
+        return descendant_t(t + delay, i);
+    }
+
+    template<typename rng_t>
+    std::optional<Time> next(uint32_t i, Time t, rng_t& rng)
+    {
+        while (true){
+            const double sigma = advance_clock(
+                exponential(rng),
+                s[i],
+                Lambda_inv[i]
+            );
+            if (super.joins(std::max(sigma, 0.0))){
+                s[i] = -super.clock();
+                return std::max(t, ti[i] + super.age());
+            }
+            if (sigma <= 0.0){
+                free_slots.push_back(i);
+                return std::optional<Time>();
+            }
+            if (sigma < tolerance * Lambda_inv[i]){
+                retire(1.0 + sigma / Lambda_inv[i]);
+                free_slots.push_back(i);
+                return std::optional<Time>();
+            }
+            s[i] = sigma;
+            const Time delay = kernel.inverse_survival(sigma);
+            if constexpr (thinned){
+                if (uniform_0_1(rng()) >= kernel.acceptance(delay))
+                    continue;
+            }
+
+            /* Round-off may place the descendant marginally before the
+             * previous one, which would break the time order of the
+             * queue, so clamp it: */
+            return std::max(t, ti[i] + delay);
+        }
+    }
+
+    /*
+     * Expected number of descendants (candidates, if thinned) after t
+     * of a parent at ti < t:
+     */
+    double remaining(Time t, Time ti, double f_M) const
+    {
+        return Lambda(f_M) * kernel.survival(t - ti);
+    }
+
+    /*
+     * Register a parent at ti < t given the history up to t, and
+     * return its first descendant after t (if any). The descendants
+     * after t form a Poisson process of rate Lambda on the transformed
+     * clock, which starts at S(t - ti) = w / Lambda, where w is the
+     * parent's `remaining`.
+     */
+    template<typename rng_t>
+    std::optional<descendant_t> resume(
+        Time t,
+        Time ti,
+        double f_M,
+        double w,
+        rng_t& rng
+    )
+    {
+        if (t - ti >= super.age()){
+            super.add(t, ti, Lambda(f_M), w, rng);
+            return std::optional<descendant_t>();
+        }
+        const double E = exponential(rng);
+        const double Lambda_inv = 1.0 / Lambda(f_M);
+        const double sigma
+            = (E < w) ? advance_clock(E, w * Lambda_inv, Lambda_inv) : 0.0;
+        if (super.joins(sigma)){
+            const uint32_t i = insert(ti, -super.clock(), Lambda_inv);
+            return descendant_t(std::max(t, ti + super.age()), i);
+        }
+        if (E >= w)
+            return std::optional<descendant_t>();
+        if (sigma < tolerance * Lambda_inv){
+            retire(1.0 + sigma / Lambda_inv);
+            return std::optional<descendant_t>();
+        }
+        const uint32_t i = insert(ti, sigma, Lambda_inv);
+        const Time delay = kernel.inverse_survival(sigma);
+        if constexpr (thinned){
+            if (uniform_0_1(rng()) >= kernel.acceptance(delay)){
+                std::optional<Time> tnext(next(i, t, rng));
+                if (!tnext)
+                    return std::optional<descendant_t>();
+                return descendant_t(*tnext, i);
+            }
+        }
+        return descendant_t(std::max(t, ti + delay), i);
+    }
+
+    /*
+     * Whether the queue entry of parent i is its age A, and the
+     * transfer of the parent to the super-parents at that age t:
+     */
+    bool joining(uint32_t i) const
+    {
+        return s[i] < 0.0;
+    }
+
+    template<typename rng_t>
+    void join(uint32_t i, Time t, rng_t& rng)
+    {
+        super.add(t, ti[i], 1.0 / Lambda_inv[i], -s[i] / Lambda_inv[i], rng);
+        free_slots.push_back(i);
+    }
+
+    const SuperParents<kernel_t>& super_parents() const
+    {
+        return super;
+    }
+
+    SuperParents<kernel_t>& super_parents()
+    {
+        return super;
+    }
+
+    /* Remove all parents: */
+    void clear()
+    {
+        ti.clear();
+        s.clear();
+        Lambda_inv.clear();
+        free_slots.clear();
+        super.clear();
+    }
+
+    /*
+     * Whether a past parent with w expected descendants left is
+     * retired right away, and its retirement:
+     */
+    bool negligible(double w) const
+    {
+        return w < tolerance;
+    }
+
+    void retire(double w)
+    {
+        ++n_retired;
+        w_retired += w;
+    }
+
+    /* Number of retired parents and their remaining descendants: */
+    size_t retired() const
+    {
+        return n_retired;
+    }
+
+    double retired_offspring() const
+    {
+        return w_retired;
+    }
+
+    /* Size of the parent table: */
+    size_t capacity() const
+    {
+        return ti.size();
+    }
+
 private:
-    static Frequency critical_FK(
-        double Mmin,
-        double Mmax,
-        double p,
-        Time c,
-        Time Tref,
-        double beta,
-        double alpha
+    static constexpr bool thinned = requires(const kernel_t& k, Time dt)
+    {
+        k.acceptance(dt);
+    };
+
+    /* Expected number of descendants (candidates, if thinned): */
+    double Lambda(double f_M) const
+    {
+        if constexpr (thinned)
+            return expected_offspring(f_M, process) * kernel.envelope_factor;
+        return expected_offspring(f_M, process);
+    }
+
+    const Process_M_t& process;
+    const kernel_t kernel;
+
+    /* Retirement of parents: */
+    double tolerance;
+    size_t n_retired = 0;
+    double w_retired = 0.0;
+
+    SuperParents<kernel_t> super;
+
+    /* Occurrence times of the parents: */
+    std::vector<Time> ti;
+
+    /*
+     * Transformed clock at the last descendant of the parents, and
+     * -S(A) for parents that join the super-parents at their age A:
+     */
+    std::vector<double> s;
+
+    /* Inverse of the expected number of descendants of the parents: */
+    std::vector<double> Lambda_inv;
+
+    std::vector<uint32_t> free_slots;
+
+    uint32_t insert(Time t, double s_i, double Lambda_inv_i)
+    {
+        if (!free_slots.empty()){
+            const uint32_t i = free_slots.back();
+            free_slots.pop_back();
+            ti[i] = t;
+            s[i] = s_i;
+            Lambda_inv[i] = Lambda_inv_i;
+            return i;
+        }
+        if (ti.size() == std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Too many parents in the queue.");
+        ti.push_back(t);
+        s.push_back(s_i);
+        Lambda_inv.push_back(Lambda_inv_i);
+        return ti.size() - 1;
+    }
+};
+
+
+/*
+ * Draws the total number of descendants of a parent once from a
+ * Poisson distribution with its expected number of descendants as
+ * the mean, and then produces their times in increasing order.
+ * Given that m descendants remain after the transformed clock sigma,
+ * they are uniformly distributed on (0, sigma). The next one is the
+ * largest,
+ *    sigma' = sigma * V ** (1/m),
+ * with V uniform on (0,1], that is, -log(V) is a unit exponential
+ * (see exponential.hpp). We track log(sigma), so that each descendant
+ * costs an exponential variate and the inversion of the kernel.
+ * For parents with many remaining descendants, the times are generated
+ * in blocks of BLOCK descendants. The loops over a block are free of
+ * dependencies (apart from a prefix sum) and can be vectorized.
+ */
+template<typename kernel_t>
+class CountSampler {
+public:
+    CountSampler(
+        const Process_M_t& process,
+        const kernel_t& kernel,
+        const GenerationOptions& options
+    ) : process(process), kernel(kernel),
+        log_tolerance(std::log(options.retire_tolerance)),
+        super(kernel, options.aggregate_age * process.c,
+              options.aggregate_width),
+        log_s_A(std::log(super.clock()))
+    {}
+
+    template<typename rng_t>
+    std::optional<descendant_t> first(Time t, double f_M, rng_t& rng)
+    {
+        const double Lambda = expected_offspring(f_M, process);
+        if (Lambda <= 0.0)
+            return std::optional<descendant_t>();
+        std::poisson_distribution<uint32_t> poisson(Lambda);
+        const uint32_t k = poisson(rng);
+        if (k == 0){
+            if (!super.joins(0.0))
+                return std::optional<descendant_t>();
+            const uint32_t i = insert(t, k, Lambda);
+            return descendant_t(*schedule_join(i, t), i);
+        }
+        const uint32_t i = insert(t, k, Lambda);
+        std::optional<Time> tnext(next(i, t, rng));
+        if (!tnext)
+            return std::optional<descendant_t>();
+        return descendant_t(*tnext, i);
+    }
+
+    template<typename rng_t>
+    std::optional<Time> next(uint32_t i, Time t, rng_t& rng)
+    {
+        /*
+         * Descendants from a precomputed block:
+         */
+        if (block[i] != NO_BLOCK){
+            block_t& b = blocks[block[i]];
+            if (cursor[i] < b.size)
+                return std::max(t, b.t[cursor[i]++]);
+            free_blocks.push_back(block[i]);
+            block[i] = NO_BLOCK;
+        }
+
+        /*
+         * The last block may have taken the parent beyond the age A
+         * of the super-parents:
+         */
+        if (log_s[i] < log_s_A){
+            super.add(t, ti[i], std::exp(log_Lambda[i]),
+                      std::exp(log_Lambda[i] + log_s[i]), rng);
+            free_slots.push_back(i);
+            return std::optional<Time>();
+        }
+        if (m[i] == 0){
+            if (super.joins(0.0))
+                return schedule_join(i, t);
+            free_slots.push_back(i);
+            return std::optional<Time>();
+        }
+
+        /*
+         * Single descendant. As in the ClockSampler, clamp the time
+         * against round-off.
+         */
+        if (m[i] < BLOCK){
+            log_s[i] -= exponential(rng) / m[i];
+            if (log_s[i] < log_s_A)
+                return schedule_join(i, t);
+            if (log_s[i] + log_Lambda[i] < log_tolerance){
+                retire(m[i]);
+                free_slots.push_back(i);
+                return std::optional<Time>();
+            }
+            --m[i];
+            return std::max(t, ti[i] + kernel.inverse_log_survival(log_s[i]));
+        }
+
+        /*
+         * Generate a block:
+         */
+        if (free_blocks.empty()){
+            free_blocks.push_back(blocks.size());
+            blocks.emplace_back();
+        }
+        const uint32_t j = free_blocks.back();
+        free_blocks.pop_back();
+        block_t& b = blocks[j];
+        std::array<uint64_t,BLOCK> w;
+        std::array<double,BLOCK> lv;
+        for (unsigned int k=0; k<BLOCK; ++k)
+            w[k] = rng();
+        exponential_block(w.data(), lv.data(), BLOCK, rng);
+        for (unsigned int k=0; k<BLOCK; ++k)
+            lv[k] = -lv[k] / (m[i] - k);
+        double ls = log_s[i];
+        for (unsigned int k=0; k<BLOCK; ++k){
+            ls += lv[k];
+            lv[k] = ls;
+        }
+        if (lv[0] < log_s_A){
+            free_blocks.push_back(j);
+            return schedule_join(i, t);
+        }
+        if (lv[0] + log_Lambda[i] < log_tolerance){
+            free_blocks.push_back(j);
+            retire(m[i]);
+            free_slots.push_back(i);
+            return std::optional<Time>();
+        }
+        for (unsigned int k=0; k<BLOCK; ++k)
+            b.t[k] = ti[i] + kernel.inverse_log_survival(lv[k]);
+        b.size = BLOCK;
+        log_s[i] = ls;
+        m[i] -= BLOCK;
+        block[i] = j;
+        cursor[i] = 1;
+        return std::max(t, b.t[0]);
+    }
+
+    /*
+     * Expected number of descendants after t of a parent at ti < t:
+     */
+    double remaining(Time t, Time ti, double f_M) const
+    {
+        return expected_offspring(f_M, process) * kernel.survival(t - ti);
+    }
+
+    /*
+     * Register a parent at ti < t given the history up to t, and
+     * return its first descendant after t (if any). Its descendants
+     * after t are Poisson distributed with mean w, the parent's
+     * `remaining`, and uniformly distributed on the transformed clock
+     * below S(t - ti). Most past events have none, which is decided
+     * by the first arrival E of a unit-rate Poisson process on [0, w].
+     * Given E < w, the remaining count is Poisson with mean w - E.
+     */
+    template<typename rng_t>
+    std::optional<descendant_t> resume(
+        Time t,
+        Time ti,
+        double f_M,
+        double w,
+        rng_t& rng
     )
     {
-        Time tau = std::pow(Tref / c, p)
-            * c * beta * std::exp((beta - alpha) * Mmin)
-            / ((p - 1.0) * (1.0 - std::exp(-beta * (Mmax - Mmin))));
-        if (alpha == beta){
-            /*
-             * Integrate a constant over M:
-             */
-            return 1.0 / (tau * (Mmax - Mmin));
+        const double Lambda = expected_offspring(f_M, process);
+        if (t - ti >= super.age()){
+            super.add(t, ti, Lambda, w, rng);
+            return std::optional<descendant_t>();
+        }
+        const double E = exponential(rng);
+        if (E >= w){
+            if (!super.joins(0.0))
+                return std::optional<descendant_t>();
+            const uint32_t i = insert(ti, 0, Lambda);
+            return descendant_t(*schedule_join(i, t), i);
+        }
+        std::poisson_distribution<uint32_t> poisson(w - E);
+        const uint32_t k = 1 + poisson(rng);
+        const uint32_t i = insert(ti, k, Lambda);
+        log_s[i] = std::log(w / Lambda);
+        std::optional<Time> tnext(next(i, t, rng));
+        if (!tnext)
+            return std::optional<descendant_t>();
+        return descendant_t(*tnext, i);
+    }
+
+    /* See ClockSampler: */
+    bool joining(uint32_t i) const
+    {
+        return m[i] == JOINING;
+    }
+
+    template<typename rng_t>
+    void join(uint32_t i, Time t, rng_t& rng)
+    {
+        const double Lambda = std::exp(log_Lambda[i]);
+        super.add(t, ti[i], Lambda, Lambda * super.clock(), rng);
+        free_slots.push_back(i);
+    }
+
+    const SuperParents<kernel_t>& super_parents() const
+    {
+        return super;
+    }
+
+    SuperParents<kernel_t>& super_parents()
+    {
+        return super;
+    }
+
+    /* Remove all parents: */
+    void clear()
+    {
+        ti.clear();
+        log_s.clear();
+        log_Lambda.clear();
+        m.clear();
+        block.clear();
+        cursor.clear();
+        free_slots.clear();
+        blocks.clear();
+        free_blocks.clear();
+        super.clear();
+    }
+
+    /*
+     * Whether a past parent with w expected descendants left is
+     * retired right away, and its retirement:
+     */
+    bool negligible(double w) const
+    {
+        return std::log(w) < log_tolerance;
+    }
+
+    void retire(double w)
+    {
+        ++n_retired;
+        w_retired += w;
+    }
+
+    /* Number of retired parents and their remaining descendants: */
+    size_t retired() const
+    {
+        return n_retired;
+    }
+
+    double retired_offspring() const
+    {
+        return w_retired;
+    }
+
+    /* Size of the parent table: */
+    size_t capacity() const
+    {
+        return ti.size();
+    }
+
+private:
+    static constexpr unsigned int BLOCK = 16;
+    static constexpr uint32_t NO_BLOCK = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t JOINING = std::numeric_limits<uint32_t>::max();
+
+    struct block_t {
+        std::array<Time,BLOCK> t;
+        unsigned int size;
+    };
+
+    const Process_M_t& process;
+    const kernel_t kernel;
+
+    /* Retirement of parents: */
+    double log_tolerance;
+    size_t n_retired = 0;
+    double w_retired = 0.0;
+
+    /* Super-parents and the logarithm of their clock S(A): */
+    SuperParents<kernel_t> super;
+    double log_s_A;
+
+    /* Occurrence times of the parents: */
+    std::vector<Time> ti;
+
+    /* Logarithm of the transformed clock at the last descendant: */
+    std::vector<double> log_s;
+
+    /* Logarithm of the expected number of descendants: */
+    std::vector<double> log_Lambda;
+
+    /*
+     * Number of remaining descendants (apart from the block), or
+     * JOINING if the parent joins the super-parents at its age A:
+     */
+    std::vector<uint32_t> m;
+
+    /* Block of precomputed descendant times and position within: */
+    std::vector<uint32_t> block;
+    std::vector<uint8_t> cursor;
+
+    std::vector<uint32_t> free_slots;
+    std::vector<block_t> blocks;
+    std::vector<uint32_t> free_blocks;
+
+    /*
+     * Replace the next descendant of parent i, which falls beyond its
+     * age A, by its transfer to the super-parents at that age:
+     */
+    std::optional<Time> schedule_join(uint32_t i, Time t)
+    {
+        log_s[i] = log_s_A;
+        m[i] = JOINING;
+        return std::max(t, ti[i] + super.age());
+    }
+
+    uint32_t insert(Time t, uint32_t k, double Lambda)
+    {
+        const double log_Lambda_i = std::log(Lambda);
+        if (!free_slots.empty()){
+            const uint32_t i = free_slots.back();
+            free_slots.pop_back();
+            ti[i] = t;
+            log_s[i] = 0.0;
+            log_Lambda[i] = log_Lambda_i;
+            m[i] = k;
+            block[i] = NO_BLOCK;
+            cursor[i] = 0;
+            return i;
+        }
+        if (ti.size() == std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Too many parents in the queue.");
+        ti.push_back(t);
+        log_s.push_back(0.0);
+        log_Lambda.push_back(log_Lambda_i);
+        m.push_back(k);
+        block.push_back(NO_BLOCK);
+        cursor.push_back(0);
+        return ti.size() - 1;
+    }
+};
+
+
+/*
+ * The reference implementation: generate the events one by one from
+ * a priority queue of the intensity components. The background events
+ * and the magnitudes are pre-generated in blocks (see eventstream.hpp).
+ *
+ * The generator can be burned in once and then forked into copies
+ * that continue with their own random numbers. Given the history up
+ * to the fork time T, the future of the process depends only on the
+ * times and productivities of the past events, not on the random
+ * numbers that generated them. Hence, the burn-in records the history
+ * of the events that remain active at T, and each fork restarts the
+ * samplers at T from it (see `resume` of the samplers). The samplers'
+ * own state cannot be shared: the last draws of a parent, including
+ * whether it has any further descendants, already look beyond T. The
+ * expected number of descendants after T of each past event is
+ * computed once, so that a fork costs one random number for most past
+ * events.
+ */
+template<typename queue_t, typename sampler_t, typename magnitudes_t>
+class SequentialGenerator {
+public:
+    template<typename kernel_t>
+    SequentialGenerator(
+        const Process_M_t& process,
+        const kernel_t& kernel,
+        const magnitudes_t& magnitudes,
+        size_t seed,
+        const GenerationOptions& options
+    ) : process(process),
+        rng(seed, options.engine, options.rng_thread, options.bit_source),
+        events(process, magnitudes, seed), sampler(process, kernel, options)
+    {
+        next_bg = events.next_background();
+    }
+
+    /*
+     * Fork the generator with a new seed:
+     */
+    SequentialGenerator(const SequentialGenerator& state, size_t seed)
+       : process(state.process),
+         rng(seed, state.rng.engine(), state.rng.pipelined()),
+         events(state.events, seed),
+         t(state.t), sampler(state.sampler), history(state.history)
+    {
+        restart();
+    }
+
+    /*
+     * Generate the events and pass them to the sink, which discards
+     * the burn-in and stores the catalog:
+     */
+    template<typename sink_t>
+    void run(sink_t& sink)
+    {
+        while (!sink.done()){
+            next_event();
+            if constexpr (requires { sink.observe(true, size_t()); })
+                sink.observe(background, descendants.size());
+            sink.push(t, M);
+        }
+    }
+
+    /*
+     * Generate all events before T without storing them, and advance
+     * the current time to T. The times and productivities of the
+     * events are kept so that the generator can be forked at T. The
+     * events that have no descendants after T (or are retired) are
+     * dropped once the history has doubled, so that it stays
+     * proportional to the parents that remain active at T.
+     */
+    void advance(Time T)
+    {
+        constexpr size_t PRUNE_MIN = 1024;
+        std::shared_ptr<history_t> h = std::make_shared<history_t>();
+        if (history)
+            *h = *history;
+        size_t n_pruned = h->t.size();
+        while (next_time() < T){
+            next_event();
+            h->t.push_back(t);
+            h->f.push_back(f);
+            if (h->t.size() >= std::max(2 * n_pruned, PRUNE_MIN)){
+                prune(*h, T);
+                n_pruned = h->t.size();
+            }
+        }
+        t = T;
+        M = std::numeric_limits<double>::quiet_NaN();
+        set_history(std::move(h));
+    }
+
+    /*
+     * Start from the past events at times ti < t and productivities
+     * fi instead of the empty process (see stationary_history):
+     */
+    void initialize(std::vector<Time>&& ti, std::vector<double>&& fi)
+    {
+        std::shared_ptr<history_t> h = std::make_shared<history_t>();
+        h->t = std::move(ti);
+        h->f = std::move(fi);
+        set_history(std::move(h));
+    }
+
+    /*
+     * Report the retired parents, the size of the parent table, and
+     * the super-parents:
+     */
+    void report(GenerationInfo& info) const
+    {
+        info.retired_parents = sampler.retired();
+        info.retired_offspring = sampler.retired_offspring();
+        info.parent_capacity = sampler.capacity();
+        info.joined_parents = sampler.super_parents().joined();
+        info.super_parents = sampler.super_parents().peak();
+    }
+
+private:
+    const Process_M_t& process;
+
+    /* The RNG of the triggering, and the background and magnitudes: */
+    RandomPipeline rng;
+    EventStream<magnitudes_t> events;
+
+    /*
+     * Time, magnitude, and productivity of the current event, and
+     * whether it is a background event:
+     */
+    Time t = 0.0 * bu::si::seconds;
+    double M = std::numeric_limits<double>::quiet_NaN();
+    double f = 0.0;
+    bool background = false;
+
+    /* The next background occurrence: */
+    Time next_bg;
+
+    /*
+     * A priority queue of future descendants of the intensity
+     * components:
+     */
+    queue_t descendants;
+    sampler_t sampler;
+
+    /*
+     * Times and productivities of the events before t, and their
+     * expected number of descendants after t. Forks share the history
+     * of their state.
+     */
+    struct history_t {
+        std::vector<Time> t;
+        std::vector<double> f;
+        std::vector<double> w;
+    };
+    std::shared_ptr<const history_t> history;
+
+    /*
+     * Compute the expected number of descendants after T of the events
+     * of the history, and drop the events that have none (or are
+     * retired):
+     */
+    void prune(history_t& h, Time T)
+    {
+        size_t n = 0;
+        h.w.resize(h.t.size());
+        for (size_t j=0; j<h.t.size(); ++j){
+            const double w = sampler.remaining(T, h.t[j], h.f[j]);
+            if (!(w > 0.0))
+                continue;
+            if (sampler.negligible(w)){
+                sampler.retire(w);
+                continue;
+            }
+            h.t[n] = h.t[j];
+            h.f[n] = h.f[j];
+            h.w[n] = w;
+            ++n;
+        }
+        h.t.resize(n);
+        h.f.resize(n);
+        h.w.resize(n);
+    }
+
+    /*
+     * Set the history before t, dropping the events without
+     * descendants after t, and restart:
+     */
+    void set_history(std::shared_ptr<history_t> h)
+    {
+        prune(*h, t);
+        history = std::move(h);
+        restart();
+    }
+
+    /*
+     * Redraw all future occurrences after t from the history:
+     */
+    void restart()
+    {
+        events.restart(t);
+        next_bg = events.next_background();
+        descendants = queue_t();
+        sampler.clear();
+        if (!history)
+            return;
+        for (size_t j=0; j<history->t.size(); ++j){
+            std::optional<descendant_t> child(
+                sampler.resume(
+                    t, history->t[j], history->f[j], history->w[j], rng
+                )
+            );
+            if (child)
+                descendants.push(*child);
+        }
+    }
+
+    /*
+     * Hand the parents that reach the age of the super-parents before
+     * the next event over to them:
+     */
+    void settle()
+    {
+        while (!descendants.empty()){
+            const descendant_t& top = descendants.top();
+            if (!sampler.joining(top.parent) || top.tnext > next_bg
+                || top.tnext > sampler.super_parents().next())
+                return;
+            sampler.join(top.parent, top.tnext, rng);
+            descendants.pop();
+        }
+    }
+
+    Time next_time()
+    {
+        settle();
+        const Time t_super = sampler.super_parents().next();
+        if (descendants.empty() || next_bg < descendants.top().tnext)
+            return std::min(next_bg, t_super);
+        return std::min(descendants.top().tnext, t_super);
+    }
+
+    void next_event()
+    {
+        /*
+         * Get the next occurrence time:
+         */
+        settle();
+        const Time t_super = sampler.super_parents().next();
+        if (t_super < next_bg && (descendants.empty()
+                                  || t_super < descendants.top().tnext))
+        {
+            /* Descendant of the super-parents: */
+            t = t_super;
+            background = false;
+            sampler.super_parents().fire(rng);
+        } else if (descendants.empty() || next_bg < descendants.top().tnext){
+            /* Background event */
+            t = next_bg;
+            background = true;
+            next_bg = events.next_background();
         } else {
-            return 1.0 / (tau * (
-                std::exp((alpha-beta) * Mmax)
-                - std::exp((alpha-beta) * Mmin)
-            ));
+            /* Descendant event. Take it from the top of the queue: */
+            descendant_t event(descendants.top());
+            t = event.tnext;
+            background = false;
+
+            /* Check whether we generate a new descendant event from the
+             * initial. If so, it replaces the current one in the queue: */
+            std::optional<Time> tnext(
+                sampler.next(event.parent, t, rng)
+            );
+            if (tnext){
+                event.tnext = *tnext;
+                replace_top(descendants, event);
+            } else {
+                descendants.pop();
+            }
         }
+
+
+        /*
+         * Get the next magnitude:
+         */
+        const magnitude_t m = events.next_magnitude();
+        M = m.M;
+        f = m.f;
+
+        /*
+         * Check whether this earthquake triggers another:
+         */
+        std::optional<descendant_t> child(sampler.first(t, m.f, rng));
+        if (child)
+            descendants.push(*child);
     }
 };
 
 
-// static Frequency single_rate(
-//     Time t,
-//     Time ti,
-//     Scalar Mi,
-//     const Process_M_t& process
-// )
-// {
-//     return process.FK * std::exp(
-//         -process.beta * (Mi - process.Mr)
-//         + process.ln_p * std::log(
-//             process.Tref / (t - ti + process.c)
-//         )
-//     );
-// }
+
+/*
+ * Set the initial state of the sequential generator:
+ */
+template<typename generator_t, typename magnitudes_t>
+static void initialize(
+    generator_t& generator,
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options
+)
+{
+    if (options.initialization == Initialization::stationary){
+        std::vector<Time> t;
+        std::vector<double> f;
+        stationary_history(process, magnitudes, seed, options, t, f);
+        generator.initialize(std::move(t), std::move(f));
+    }
+}
 
 
 /*
- * Compute the time of the next descendant
+ * Select the sampler and the queue, and call fun(generator):
  */
-static double f(double M, const Process_M_t& process)
+template<typename kernel_t, typename magnitudes_t, typename fun_t>
+static void with_sequential_generator(
+    const Process_M_t& process,
+    const kernel_t& kernel,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    fun_t&& fun
+)
 {
-    return std::exp(process.alpha * (M - process.Mmin));
+    auto with_queue = [&]<template<typename> typename sampler_t>()
+    {
+        typedef sampler_t<kernel_t> sampler;
+        switch (options.queue){
+            case Queue::binary:
+            {
+                SequentialGenerator<std::priority_queue<descendant_t>,
+                                    sampler, magnitudes_t>
+                    gen(process, kernel, magnitudes, seed, options);
+                fun(gen);
+                break;
+            }
+            case Queue::dary:
+            {
+                SequentialGenerator<DaryHeap<descendant_t>, sampler,
+                                    magnitudes_t>
+                    gen(process, kernel, magnitudes, seed, options);
+                fun(gen);
+                break;
+            }
+            case Queue::radix:
+            {
+                SequentialGenerator<RadixHeap<descendant_t>, sampler,
+                                    magnitudes_t>
+                    gen(process, kernel, magnitudes, seed, options);
+                fun(gen);
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown queue.");
+        }
+    };
+    if (options.sampling == Sampling::clock)
+        with_queue.template operator()<ClockSampler>();
+    else if (options.sampling == Sampling::count)
+        with_queue.template operator()<CountSampler>();
+    else
+        throw std::runtime_error("Unknown sampling.");
 }
 
-// static double Lambda_i(
-//     Time ti,
-//     Time tl,
-//     Time tr,
-//     double Mi,
-//     const Process_M_t& process
-// )
-// {
-//     /*
-//      * FK = K / Tref ** p
-//      * Thereby:
-//      *    Tref * FK * ((tr - ti + c)/Tref) ** (1-p)
-//      *    = Tref * (K * Tref ** -p) * (tr - ti + c) ** (1-p)
-//      *      * Tref ** (p - 1)
-//      *    = K * (tr - ti + c) ** (1-p)
-//      */
-//     double _1mp = 1.0 - process.p;
-//     return f(Mi, process) * process.Tref * process.FK / _1mp * (
-//         std::pow((tr - ti + process.c) / process.Tref, _1mp)
-//         - std::pow((tl - ti + process.c) / process.Tref, _1mp)
-//     );
-// }
-
-static double Lambda_i_oo(
-    Time ti,
-    Time tl,
-    double Mi,
-    const Process_M_t& process
+
+template<typename magnitudes_t, typename sink_t>
+static void generate(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    sink_t& sink
 )
 {
-    /*
-     * FK = K / Tref ** p
-     * Thereby:
-     *    Tref * FK * ((tr - ti + c)/Tref) ** (1-p)
-     *    = Tref * (K * Tref ** -p) * (tr - ti + c) ** (1-p)
-     *      * Tref ** (p - 1)
-     *    = K * (tr - ti + c) ** (1-p)
-     */
-    double _1mp = 1.0 - process.p;
-    return -f(Mi, process) * process.Tref * process.FK / _1mp *
-        std::pow((tl - ti + process.c) / process.Tref, _1mp);
+    switch (options.method){
+        case Method::sequential:
+            with_kernel(process, options, [&](const auto& kernel)
+            {
+                with_sequential_generator(
+                    process, kernel, magnitudes, seed, options,
+                    [&](auto& generator)
+                    {
+                        initialize(generator, process, magnitudes, seed,
+                                   options);
+                        generator.run(sink);
+                        generator.report(info);
+                    }
+                );
+            });
+            break;
+        case Method::cluster:
+            generate_cluster(
+                process, magnitudes, seed, options, sink
+            );
+            break;
+        case Method::exponential_sum:
+            if (options.kernel != Kernel::omori)
+                throw std::runtime_error(
+                    "The exponential_sum method requires the Omori kernel."
+                );
+            generate_exponential_sum(
+                process, magnitudes, seed, options, info, sink
+            );
+            break;
+        default:
+            throw std::runtime_error("Unknown generation method.");
+    }
 }
 
-
-static std::optional<Time> next_single_occurrence(
-    double q,
-    Time ti,
-    double Mi,
-    Time tl,
-    const Process_M_t& process
+/*
+ * Validate the parameters of the process:
+ */
+static void validate_parameters(
+    double Mmin,
+    double Mmax,
+    double p,
+    Time c,
+    double offspring_fraction,
+    const GenerationOptions& options
 )
 {
-    /* Early exit if no occurrence in finite time: */
-    if (q <= std::exp(-Lambda_i_oo(ti, tl, Mi, process)))
-        return std::optional<Time>();
+    /* Sanity: */
+    if (Mmin >= Mmax)
+        throw std::runtime_error("Mmin >= Mmax");
+    //if (beta < )
+    if (p <= 1.0)
+        throw std::runtime_error("p <= 1");
+    if (!(c > 0.0 * bu::si::seconds))
+        throw std::runtime_error("c needs to be positive.");
+    if (offspring_fraction >= 1.0)
+        throw std::runtime_error("Instable process (offspring ratio > 1)");
+    else if (offspring_fraction < 0.0)
+        throw std::runtime_error("Offspring ratio needs to be non-negative.");
 
-    /*
-     * Note here that we extract a factor Tref ** (1 - p)
-     * from the outer logarithm.
-     * The first summand has just the right exponent! So
-     * we can simply divide by Tref.
-     * The second summand is more tricky. However, note that
-     *    K = FK * Tref ** p,
-     * so that
-     *    (1/K) / Tref ** (1 - p)
-     *       = 1 / (FK * Tref ** p * Tref ** (1 - p))
-     *       = 1 / (FK * Tref)
-     */
-    double _1mp = 1.0 - process.p;
-    return ti - process.c + process.Tref * std::exp(
-        1.0 / _1mp * std::log(
-            std::pow((tl - ti + process.c) / process.Tref, _1mp)
-            - _1mp / (f(Mi, process) * process.FK * process.Tref) * std::log(q)
-       )
-    );
+    if ((options.kernel == Kernel::tapered_omori
+         || options.kernel == Kernel::truncated_omori
+         || options.kernel == Kernel::custom)
+        && options.kernel_tau <= 0.0)
+        throw std::runtime_error("kernel_tau needs to be positive.");
+    if (options.kernel == Kernel::custom
+        && options.method == Method::sequential
+        && options.sampling == Sampling::count)
+        throw std::runtime_error(
+            "The count sampling requires a kernel with closed-form inverse."
+        );
+    if (options.initialization == Initialization::stationary){
+        if (options.method != Method::sequential)
+            throw std::runtime_error(
+                "The stationary initialization requires the sequential "
+                "method."
+            );
+        if (!(options.init_window > 0.0)
+            || !std::isfinite(options.init_window))
+            throw std::runtime_error("init_window needs to be positive.");
+        if (!(options.init_tolerance >= 0.0))
+            throw std::runtime_error(
+                "init_tolerance needs to be non-negative."
+            );
+    }
+    if (!(options.retire_tolerance >= 0.0))
+        throw std::runtime_error("retire_tolerance needs to be non-negative.");
+    if (!(options.aggregate_age >= 0.0)
+        || !std::isfinite(options.aggregate_age))
+        throw std::runtime_error("aggregate_age needs to be non-negative.");
+    if (!(options.aggregate_width > 0.0 && options.aggregate_width <= 1.0))
+        throw std::runtime_error("aggregate_width needs to be in (0, 1].");
 }
 
 
-static Time next_background_occurrence(
-    double q,
-    Time tl,
-    const Process_M_t& process
+/*
+ * Set up the process for a magnitude distribution:
+ */
+template<typename magnitudes_t>
+static Process_M_t make_process(
+    Frequency mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    Time c,
+    double offspring_fraction,
+    const magnitudes_t& magnitudes,
+    const GenerationOptions& options
 )
 {
-    return tl - std::log(q) / process.mu_0;
+    /* Normalization: */
+    constexpr Time Tref = 1.0 * bu::si::seconds;
+
+    return Process_M_t(
+        mu_0,
+        Tref,
+        c,
+        beta,
+        alpha,
+        p,
+        Mmin,
+        Mmax,
+        offspring_fraction,
+        magnitudes.mean_productivity(),
+        (options.background == Background::constant)
+            ? BackgroundRate(mu_0)
+            : BackgroundRate(
+                mu_0,
+                options.background_times,
+                options.background_factors,
+                options.background == Background::piecewise_linear
+            )
+    );
 }
 
 
-static double draw_magnitude(
-    double q,
+/*
+ * Validate the parameters, set up the process, and call
+ * fun(process, magnitudes):
+ */
+template<typename fun_t>
+static void with_process(
+    const cyantities::QuantityWrapper& mu_0,
     double Mmin,
     double Mmax,
-    double beta
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const GenerationOptions& options,
+    fun_t&& fun
 )
 {
-    return Mmin - std::log(
-            1.0 - q * (1.0 - std::exp(-beta * (Mmax - Mmin)))
-    ) / beta;
+    validate_parameters(
+        Mmin, Mmax, p, c.get<Time>(), offspring_fraction, options
+    );
+
+    with_magnitudes(Mmin, Mmax, beta, alpha, options,
+        [&](const auto& magnitudes)
+        {
+            const Process_M_t process = make_process(
+                mu_0.get<Frequency>(), Mmin, Mmax, beta, alpha, p,
+                c.get<Time>(), offspring_fraction, magnitudes, options
+            );
+            fun(process, magnitudes);
+        }
+    );
 }
 
 
 /*
- * This structure holds the components of the Hawkes process
- * intensity:
+ * Generate a single catalog into the sink:
  */
-struct excitement_t {
-    Time ti;
-    double M;
-    Time tnext;
-
-    /*
-     * Ordering for a priority queue that provides the
-     * next event:
-     */
-    bool operator>(const excitement_t& other) const
-    {
-        return tnext < other.tnext;
-    }
-
-    bool operator<(const excitement_t& other) const
-    {
-        return tnext > other.tnext;
-    }
-};
-
-
+template<typename sink_t>
+static void generate_catalog(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    sink_t& sink
+)
+{
+    with_process(
+        mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, options,
+        [&](const Process_M_t& process, const auto& magnitudes)
+        {
+            generate(process, magnitudes, seed, options, info, sink);
+        }
+    );
+}
 
 
 void ETAS_generate_catalog_M_t(
@@ -264,170 +1327,423 @@ void ETAS_generate_catalog_M_t(
     double offspring_fraction,
     const size_t N_skip,
     size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
     cyantities::QuantityWrapper& Mi,
     cyantities::QuantityWrapper& ti
 )
 {
-    /* Sanity: */
-    if (Mmin >= Mmax)
-        throw std::runtime_error("Mmin >= Mmax");
-    //if (beta < )
-    if (p <= 1.0)
-        throw std::runtime_error("p <= 1");
-    if (offspring_fraction >= 1.0)
-        throw std::runtime_error("Instable process (offspring ratio > 1)");
-    else if (offspring_fraction < 0.0)
-        throw std::runtime_error("Offspring ratio needs to be non-negative.");
-
     const size_t N = Mi.size();
     if (ti.size() != N)
         throw std::runtime_error("Size of M and t not compatible");
 
+    if (options.auto_burn_in){
+        with_process(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, options,
+            [&](const Process_M_t& process, const auto& magnitudes)
+            {
+                AutoCountSink sink(N_skip, process, options, info, Mi, ti);
+                generate(process, magnitudes, seed, options, info, sink);
+            }
+        );
+    } else {
+        CountSink sink(N_skip, Mi, ti);
+        generate_catalog(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, seed,
+            options, info, sink
+        );
+    }
+}
 
-    /* Current number of earthquakes generated: */
-    size_t n = 0;
 
-    /* Normalization: */
-    constexpr Time Tref = 1.0 * bu::si::seconds;
+void ETAS_generate_catalog_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogArena& catalog
+)
+{
+    const Time T0_ = T0.get<Time>();
+    const Time T1_ = T1.get<Time>();
+    if (!(T0_ >= 0.0 * bu::si::seconds) || !(T1_ > T0_))
+        throw std::runtime_error("The time window needs 0 <= T0 < T1.");
 
-    Process_M_t process(
-        mu_0.get<Frequency>(),
-        Tref,
-        c.get<Time>(),
-        beta,
-        alpha,
-        p,
-        Mmin,
-        Mmax,
-        offspring_fraction
+    WindowSink sink(T0_, T1_, catalog);
+    generate_catalog(
+        mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, seed,
+        options, info, sink
     );
+}
+
 
-    /* Init the RNG: */
-    std::mt19937_64 rng(seed);
-    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+/*
+ * Add the diagnostics of an ensemble member to those of the ensemble:
+ * The counts beyond those of the common initial state `base` add up,
+ * and the peaks and kernel diagnostics are the maxima over the members.
+ */
+static void accumulate(
+    GenerationInfo& info,
+    const GenerationInfo& member,
+    const GenerationInfo& base = GenerationInfo()
+)
+{
+    info.kernel_error = std::fmax(info.kernel_error, member.kernel_error);
+    info.kernel_terms = std::max(info.kernel_terms, member.kernel_terms);
+    info.retired_parents += member.retired_parents - base.retired_parents;
+    info.retired_offspring
+        += member.retired_offspring - base.retired_offspring;
+    info.joined_parents += member.joined_parents - base.joined_parents;
+    info.parent_capacity
+        = std::max(info.parent_capacity, member.parent_capacity);
+    info.super_parents = std::max(info.super_parents, member.super_parents);
+}
 
 
-    /* Time and magnitude of the current event: */
-    Time t = 0.0 * bu::si::seconds;
-    double M = std::numeric_limits<double>::quiet_NaN();
+void ETAS_generate_ensemble_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    const std::vector<size_t>& seeds,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogEnsemble& ensemble
+)
+{
+    const Time T0_ = T0.get<Time>();
+    const Time T1_ = T1.get<Time>();
+    if (!(T0_ >= 0.0 * bu::si::seconds) || !(T1_ > T0_))
+        throw std::runtime_error("The time window needs 0 <= T0 < T1.");
+    if (ensemble.n_members() != seeds.size())
+        throw std::runtime_error(
+            "Size of the ensemble and the seeds not compatible."
+        );
+    if (options.bit_source)
+        throw std::runtime_error(
+            "The members of an ensemble cannot share a bit source."
+        );
 
     /*
-     * The next background occurrence:
+     * The threads are spent on the members, which are independent.
+     * Since the size of a catalog is heavy-tailed, the members are
+     * handed out one at a time, so that a thread that finished a small
+     * catalog picks up the next member while another still works on a
+     * large one.
      */
-    Time next_bg = next_background_occurrence(
-        uniform(rng),
-        t,
-        process
+    GenerationOptions member_options(options);
+    member_options.threads = 1;
+
+    with_process(
+        mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, options,
+        [&](const Process_M_t& process, const auto& magnitudes)
+        {
+            ThreadPool pool(options.threads);
+            std::mutex info_mutex;
+            pool.parallel_for(seeds.size(),
+                [&](size_t k, unsigned int)
+                {
+                    GenerationInfo member_info;
+                    WindowSink sink(T0_, T1_, ensemble.member(k));
+                    generate(
+                        process, magnitudes, seeds[k], member_options,
+                        member_info, sink
+                    );
+                    std::lock_guard lock(info_mutex);
+                    accumulate(info, member_info);
+                }
+            );
+        }
     );
+}
 
-    /*
-     * A priority queue of future descendants of the intensity
-     * components:
-     */
-    std::priority_queue<excitement_t> descendants;
+
+void ETAS_generate_forked_ensemble_M_t_window(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    double alpha,
+    double p,
+    const cyantities::QuantityWrapper& c,
+    double offspring_fraction,
+    const cyantities::QuantityWrapper& T0,
+    const cyantities::QuantityWrapper& T1,
+    size_t seed,
+    const std::vector<size_t>& seeds,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    CatalogEnsemble& ensemble
+)
+{
+    const Time T0_ = T0.get<Time>();
+    const Time T1_ = T1.get<Time>();
+    if (!(T0_ >= 0.0 * bu::si::seconds) || !(T1_ > T0_))
+        throw std::runtime_error("The time window needs 0 <= T0 < T1.");
+    if (ensemble.n_members() != seeds.size())
+        throw std::runtime_error(
+            "Size of the ensemble and the seeds not compatible."
+        );
+    if (options.method != Method::sequential)
+        throw std::runtime_error(
+            "Forking the ensemble requires the sequential method."
+        );
+
+    with_process(
+        mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, options,
+        [&](const Process_M_t& process, const auto& magnitudes)
+        {
+            with_kernel(process, options, [&](const auto& kernel)
+            {
+                with_sequential_generator(
+                    process, kernel, magnitudes, seed, options,
+                    [&](auto& state)
+                    {
+                        /* The shared burn-in: */
+                        initialize(state, process, magnitudes, seed,
+                                   options);
+                        state.advance(T0_);
+                        GenerationInfo burn_in;
+                        state.report(burn_in);
+                        info = burn_in;
+
+                        typedef std::decay_t<decltype(state)> generator_t;
+                        ThreadPool pool(options.threads);
+                        std::mutex info_mutex;
+                        pool.parallel_for(seeds.size(),
+                            [&](size_t k, unsigned int)
+                            {
+                                generator_t member(state, seeds[k]);
+                                WindowSink sink(
+                                    T0_, T1_, ensemble.member(k)
+                                );
+                                member.run(sink);
+                                GenerationInfo member_info;
+                                member.report(member_info);
+                                std::lock_guard lock(info_mutex);
+                                accumulate(info, member_info, burn_in);
+                            }
+                        );
+                    }
+                );
+            });
+        }
+    );
+}
+
+
+void ETAS_generate_sweep_M_t(
+    const cyantities::QuantityWrapper& mu_0,
+    double Mmin,
+    double Mmax,
+    double beta,
+    const std::vector<double>& alpha,
+    const std::vector<double>& p,
+    cyantities::QuantityWrapper& c,
+    const std::vector<double>& offspring_fraction,
+    const size_t N_skip,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    cyantities::QuantityWrapper& Mi,
+    cyantities::QuantityWrapper& ti
+)
+{
+    if (options.auto_burn_in)
+        throw std::runtime_error(
+            "The automatic burn-in is not supported for sweeps."
+        );
+    if (options.bit_source)
+        throw std::runtime_error(
+            "The grid points of a sweep cannot share a bit source."
+        );
+    const size_t P = alpha.size();
+    if (p.size() != P || c.size() != P || offspring_fraction.size() != P)
+        throw std::runtime_error("Sizes of the parameter arrays not "
+                                 "compatible.");
+    if (ti.size() != Mi.size() || (P > 0 && Mi.size() % P != 0))
+        throw std::runtime_error("Size of M and t not compatible");
+    if (P == 0)
+        return;
+    const size_t N = Mi.size() / P;
 
     /*
-     * The loop body:
+     * Validate all grid points before generating any catalog:
      */
-    auto next_event = [&]()
-    {
-        /*
-         * Get the next occurrence time:
-         */
-        if (descendants.empty() || next_bg < descendants.top().tnext){
-            /* Background event */
-            t = next_bg;
-            next_bg = next_background_occurrence(
-                uniform(rng),
-                t,
-                process
+    std::vector<Time> c_;
+    c_.reserve(P);
+    for (Time ci : c.iter<Time>())
+        c_.push_back(ci);
+    for (size_t i=0; i<P; ++i){
+        try {
+            validate_parameters(
+                Mmin, Mmax, p[i], c_[i], offspring_fraction[i], options
+            );
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(
+                "Grid point " + std::to_string(i) + ": " + e.what()
             );
-        } else {
-            /* Descendant event. Pop it from the queue: */
-            excitement_t event(descendants.top());
-            descendants.pop();
-            t = event.tnext;
-
-            /* Check whether we generate a new descendant event from the
-             * initial: */
-            std::optional<Time> tnext(next_single_occurrence(
-                uniform(rng),
-                event.ti,
-                event.M,
-                t,
-                process
-            ));
-            if (tnext){
-                event.tnext = *tnext;
-                descendants.push(event);
-            }
         }
+    }
 
+    GenerationOptions point_options(options);
+    point_options.threads = 1;
 
-        /*
-         * Get the next magnitude:
-         */
-        M = draw_magnitude(
-            uniform(rng),
-            Mmin,
-            Mmax,
-            beta
-        );
+    with_magnitudes(Mmin, Mmax, beta, alpha[0], options,
+        [&](const auto& magnitudes_0)
+        {
+            /*
+             * The magnitude distribution depends on alpha through the
+             * productivity, so set up the distribution and the process
+             * of each grid point:
+             */
+            using magnitudes_t = std::decay_t<decltype(magnitudes_0)>;
+            std::vector<magnitudes_t> magnitudes;
+            std::vector<Process_M_t> processes;
+            magnitudes.reserve(P);
+            processes.reserve(P);
+            for (size_t i=0; i<P; ++i){
+                with_magnitudes(Mmin, Mmax, beta, alpha[i], options,
+                    [&](const auto& m)
+                    {
+                        using m_t = std::decay_t<decltype(m)>;
+                        if constexpr (std::is_same_v<m_t, magnitudes_t>)
+                            magnitudes.push_back(m);
+                    }
+                );
+                processes.push_back(make_process(
+                    mu_0.get<Frequency>(), Mmin, Mmax, beta, alpha[i],
+                    p[i], c_[i], offspring_fraction[i], magnitudes[i],
+                    options
+                ));
+            }
 
-        /*
-         * Check whether this earthquake triggers another:
-         */
-        std::optional<Time> tnext(next_single_occurrence(
-            uniform(rng),
-            t,
-            M,
-            t,
-            process
-        ));
-        if (tnext){
-            descendants.push(
-                excitement_t(
-                    t,
-                    M,
-                    *tnext
-                )
+            /*
+             * Generate each grid point straight into its slice
+             * [i*N, (i+1)*N) of the output, starting from iterators at
+             * the slice offsets:
+             */
+            auto M_out = Mi.iter<Scalar>();
+            auto t_out = ti.iter<Time>();
+            std::vector<CountSink::M_iter_t> M_begin;
+            std::vector<CountSink::t_iter_t> t_begin;
+            M_begin.reserve(P);
+            t_begin.reserve(P);
+            auto M_out_i = M_out.begin();
+            auto t_out_i = t_out.begin();
+            for (size_t i=0; i<P; ++i){
+                M_begin.push_back(M_out_i);
+                t_begin.push_back(t_out_i);
+                for (size_t j=0; j<N && i+1<P; ++j){
+                    ++M_out_i;
+                    ++t_out_i;
+                }
+            }
+
+            ThreadPool pool(options.threads);
+            std::mutex info_mutex;
+            pool.parallel_for(P,
+                [&](size_t i, unsigned int)
+                {
+                    GenerationInfo point_info;
+                    CountSink sink(
+                        N_skip, N, M_out, M_begin[i], t_out, t_begin[i]
+                    );
+                    generate(
+                        processes[i], magnitudes[i], seed, point_options,
+                        point_info, sink
+                    );
+                    std::lock_guard lock(info_mutex);
+                    accumulate(info, point_info);
+                }
             );
         }
-    };
+    );
+}
 
-    /*
-     * First start up the state by throwing away the first couple of
-     * earthquakes:
-     */
-    while (n < N_skip){
-        next_event();
-        ++n;
+
+/*
+ * Copy the events of an arena to the output iterators and advance
+ * them:
+ */
+template<typename M_iter_t, typename t_iter_t>
+static void copy_arena(
+    const CatalogArena& catalog,
+    M_iter_t& M_out_i,
+    t_iter_t& t_out_i
+)
+{
+    for (size_t k=0; k<catalog.n_chunks(); ++k){
+        const double* t = catalog.chunk_times(k);
+        const double* M = catalog.chunk_magnitudes(k);
+        if (!t || !M)
+            throw std::runtime_error("Chunk has been released.");
+        for (size_t i=0; i<catalog.chunk_length(k); ++i){
+            *t_out_i = t[i] * bu::si::seconds;
+            *M_out_i = M[i];
+            ++t_out_i;
+            ++M_out_i;
+        }
     }
+}
 
 
-    /*
-     * Get some ranges and iterators for the working buffers:
-     */
+void CatalogArena::copy_to(
+    cyantities::QuantityWrapper& Mi,
+    cyantities::QuantityWrapper& ti
+) const
+{
+    if (Mi.size() != size() || ti.size() != size())
+        throw std::runtime_error("Size of the output does not match the "
+                                 "catalog.");
     auto M_out = Mi.iter<Scalar>();
     auto M_out_i = M_out.begin();
     auto t_out = ti.iter<Time>();
     auto t_out_i = t_out.begin();
-    while (n < N+N_skip){
-        /*
-         * Generate next event:
-         */
-        next_event();
+    copy_arena(*this, M_out_i, t_out_i);
+}
 
-        /*
-         * Save and advance the output iterators:
-         */
-        *t_out_i = t;
-        *M_out_i = M;
-        ++t_out_i;
-        ++M_out_i;
-        ++n;
-    }
+
+void CatalogEnsemble::copy_to(
+    cyantities::QuantityWrapper& Mi,
+    cyantities::QuantityWrapper& ti
+) const
+{
+    if (Mi.size() != size() || ti.size() != size())
+        throw std::runtime_error("Size of the output does not match the "
+                                 "ensemble.");
+    auto M_out = Mi.iter<Scalar>();
+    auto M_out_i = M_out.begin();
+    auto t_out = ti.iter<Time>();
+    auto t_out_i = t_out.begin();
+    for (const std::unique_ptr<CatalogArena>& m : members)
+        copy_arena(*m, M_out_i, t_out_i);
+}
+
+
+std::vector<double> to_seconds(cyantities::QuantityWrapper& t)
+{
+    std::vector<double> t_s;
+    t_s.reserve(t.size());
+    for (Time ti : t.iter<Time>())
+        t_s.push_back(ti.value());
+    return t_s;
 }
 
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,438 @@
+/*
+ * ETAS catalog generator using the cluster representation of the
+ * Hawkes process.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/cluster.hpp>
+#include <etascatgen/kernel.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <etascatgen/sink.hpp>
+#include <etascatgen/threadpool.hpp>
+#include <etascatgen/philox.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+namespace etascatgen {
+
+/*
+ * Merge the sorted runs of events into `out` (which has to be sized
+ * to hold all events). The merge is split into as many parts as the
+ * pool has threads, using splitting times sampled from all runs.
+ */
+static void parallel_merge(
+    const std::vector<std::span<const event_t>>& runs,
+    std::vector<event_t>& out,
+    ThreadPool& pool
+)
+{
+    auto earlier = [](const event_t& e0, const event_t& e1) -> bool
+    {
+        return e0.t < e1.t;
+    };
+
+    const size_t P = (out.size() < 4096) ? 1 : pool.size();
+
+    /*
+     * Sample splitting times:
+     */
+    std::vector<Time> splitters;
+    if (P > 1){
+        std::vector<Time> samples;
+        const size_t S = 8 * P;
+        for (const std::span<const event_t>& run : runs){
+            if (run.empty())
+                continue;
+            for (size_t i=0; i<S; ++i)
+                samples.push_back(run[(i * run.size()) / S].t);
+        }
+        std::sort(samples.begin(), samples.end());
+        for (size_t j=1; j<P; ++j)
+            splitters.push_back(samples[(j * samples.size()) / P]);
+    }
+
+    /*
+     * The index range of each part within each run, and the
+     * offset of each part within the output:
+     */
+    const size_t K = runs.size();
+    std::vector<size_t> bounds((P+1) * K);
+    for (size_t k=0; k<K; ++k){
+        bounds[k] = 0;
+        for (size_t j=1; j<P; ++j){
+            event_t split(splitters[j-1], 0.0);
+            bounds[j*K + k] = std::lower_bound(
+                runs[k].begin(), runs[k].end(), split, earlier
+            ) - runs[k].begin();
+        }
+        bounds[P*K + k] = runs[k].size();
+    }
+
+    pool.parallel_for(
+        P,
+        [&](size_t j, unsigned int) -> void
+        {
+            /* Output offset of this part: */
+            size_t dest = 0;
+            for (size_t k=0; k<K; ++k)
+                dest += bounds[j*K + k];
+
+            /* K-way merge of the part: */
+            typedef std::pair<Time,size_t> head_t;
+            std::priority_queue<
+                head_t, std::vector<head_t>, std::greater<head_t>
+            > heads;
+            std::vector<size_t> pos(K);
+            for (size_t k=0; k<K; ++k){
+                pos[k] = bounds[j*K + k];
+                if (pos[k] < bounds[(j+1)*K + k])
+                    heads.emplace(runs[k][pos[k]].t, k);
+            }
+            while (!heads.empty()){
+                const size_t k = heads.top().second;
+                heads.pop();
+                out[dest++] = runs[k][pos[k]++];
+                if (pos[k] < bounds[(j+1)*K + k])
+                    heads.emplace(runs[k][pos[k]].t, k);
+            }
+        }
+    );
+}
+
+
+template<typename kernel_t, typename magnitudes_t, typename sink_t>
+static void generate_cluster(
+    const Process_M_t& process,
+    const kernel_t& kernel,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    sink_t& sink
+)
+{
+    ThreadPool pool(options.threads);
+    const unsigned int T = pool.size();
+
+    /*
+     * The number of background events per time window. We aim at
+     * roughly WINDOW_EVENTS events per window and thread, which, on
+     * average, requires (1-n) * WINDOW_EVENTS background events (n
+     * being the branching ratio).
+     * The clusters are distributed to the threads in blocks of
+     * ROOTS_PER_BLOCK consecutive background events.
+     */
+    constexpr size_t WINDOW_EVENTS = 1 << 16;
+    constexpr size_t ROOTS_PER_BLOCK = 256;
+    const double bg_fraction = 1.0 - process.offspring_fraction;
+    const size_t B_min = std::max<size_t>(
+        1,
+        static_cast<size_t>(bg_fraction * WINDOW_EVENTS * T)
+    );
+
+    /*
+     * Events that have been generated but not yet written to the
+     * catalog, and working buffers, per worker:
+     */
+    struct worker_t {
+        std::vector<event_t> pending;
+        std::vector<parent_t> generation;
+        std::vector<parent_t> offspring;
+        size_t n_ready;
+    };
+    std::vector<worker_t> workers(T);
+    size_t n_pending = 0;
+
+    std::vector<parent_t> roots;
+    std::vector<event_t> ready;
+    std::vector<std::span<const event_t>> runs(T);
+
+    /*
+     * The first word of the root event's first random block determines
+     * the waiting time since the previous background event, the second
+     * word its magnitude:
+     */
+    auto draw_root = [&](uint64_t b, Time t_prev) -> parent_t
+    {
+        philox_ctr_t u = philox4x64({0, 0, 0, 0}, cluster_key(seed, b));
+        const magnitude_t m = magnitudes.draw(uniform_0_1(u[1]));
+        return parent_t(
+            next_background_occurrence(uniform_0_1(u[0]), t_prev, process),
+            m.M,
+            m.f
+        );
+    };
+
+    /* The next background event and its cluster id: */
+    uint64_t b_next = 0;
+    parent_t next_root = draw_root(b_next, 0.0 * bu::si::seconds);
+
+    while (!sink.done()){
+        /*
+         * Draw the next B background events.
+         * Since the clusters evolve forward in time, all events
+         * before the next background event are known after simulating
+         * their clusters.
+         * To keep the partitioning below amortized O(1) per event,
+         * grow the window with the number of pending events.
+         */
+        const size_t n_blocks = (
+            std::max(B_min, static_cast<size_t>(bg_fraction * n_pending))
+            + ROOTS_PER_BLOCK - 1
+        ) / ROOTS_PER_BLOCK;
+        const size_t B = n_blocks * ROOTS_PER_BLOCK;
+        const uint64_t b0 = b_next;
+        roots.resize(B);
+        for (size_t b=0; b<B; ++b){
+            roots[b] = next_root;
+            ++b_next;
+            next_root = draw_root(b_next, next_root.t);
+        }
+        const Time t_bg = next_root.t;
+
+        /*
+         * Simulate the clusters:
+         */
+        pool.parallel_for(
+            n_blocks,
+            [&](size_t block, unsigned int w) -> void
+            {
+                worker_t& worker = workers[w];
+                const size_t b1 = (block+1) * ROOTS_PER_BLOCK;
+                for (size_t b=block*ROOTS_PER_BLOCK; b<b1; ++b){
+                    simulate_cluster(
+                        roots[b], cluster_key(seed, b0 + b), process, kernel,
+                        magnitudes,
+                        worker.pending, worker.generation, worker.offspring,
+                        INFINITE_TIME
+                    );
+                }
+            }
+        );
+
+        /*
+         * Split off the events that are final:
+         */
+        pool.parallel_for(
+            T,
+            [&](size_t k, unsigned int) -> void
+            {
+                std::vector<event_t>& pending = workers[k].pending;
+                auto ready_end = std::partition(
+                    pending.begin(), pending.end(),
+                    [t_bg](const event_t& e) -> bool
+                    {
+                        return e.t < t_bg;
+                    }
+                );
+                workers[k].n_ready = ready_end - pending.begin();
+            }
+        );
+        size_t n_ready = 0;
+        n_pending = 0;
+        for (const worker_t& worker : workers){
+            n_ready += worker.n_ready;
+            n_pending += worker.pending.size() - worker.n_ready;
+        }
+
+        if (sink.skips(n_ready, t_bg)){
+            sink.skip(n_ready);
+        } else {
+            /*
+             * Only here do we need the events ordered in time.
+             * Sort the ready events of each worker, then merge:
+             */
+            pool.parallel_for(
+                T,
+                [&](size_t k, unsigned int) -> void
+                {
+                    std::vector<event_t>& pending = workers[k].pending;
+                    std::sort(
+                        pending.begin(),
+                        pending.begin() + workers[k].n_ready,
+                        [](const event_t& e0, const event_t& e1) -> bool
+                        {
+                            return e0.t < e1.t;
+                        }
+                    );
+                }
+            );
+            for (unsigned int k=0; k<T; ++k)
+                runs[k] = std::span<const event_t>(
+                    workers[k].pending.data(), workers[k].n_ready
+                );
+            ready.resize(n_ready);
+            parallel_merge(runs, ready, pool);
+
+            for (size_t i=0; i<n_ready && !sink.done(); ++i)
+                sink.push(ready[i].t, ready[i].M);
+        }
+        for (worker_t& worker : workers)
+            worker.pending.erase(
+                worker.pending.begin(),
+                worker.pending.begin() + worker.n_ready
+            );
+    }
+}
+
+
+
+template<typename magnitudes_t, typename sink_t>
+void generate_cluster(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    sink_t& sink
+)
+{
+    with_kernel(process, options, [&](const auto& kernel)
+    {
+        generate_cluster(process, kernel, magnitudes, seed, options, sink);
+    });
+}
+
+
+template<typename magnitudes_t>
+void stationary_history(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    std::vector<Time>& t,
+    std::vector<double>& f
+)
+{
+    constexpr size_t ROOTS_PER_BLOCK = 256;
+    const Time t0 = 0.0 * bu::si::seconds;
+
+    with_kernel(process, options, [&](const auto& kernel)
+    {
+        /*
+         * The background events of the window, drawn as in the
+         * cluster method:
+         */
+        std::vector<parent_t> roots;
+        Time t_bg = -options.init_window * bu::si::seconds;
+        while (true){
+            philox_ctr_t u = philox4x64(
+                {0, 0, 0, 0}, history_key(seed, roots.size())
+            );
+            t_bg = next_background_occurrence(
+                uniform_0_1(u[0]), t_bg, process
+            );
+            if (t_bg >= t0)
+                break;
+            const magnitude_t m = magnitudes.draw(uniform_0_1(u[1]));
+            roots.emplace_back(t_bg, m.M, m.f);
+        }
+
+        /*
+         * Simulate their clusters up to t = 0 and keep the events with
+         * non-negligible remaining intensity. The events are collected
+         * per block of roots, so that their order does not depend on
+         * the distribution of the blocks to the threads.
+         */
+        struct worker_t {
+            std::vector<parent_t> events;
+            std::vector<parent_t> generation;
+            std::vector<parent_t> offspring;
+        };
+        ThreadPool pool(options.threads);
+        std::vector<worker_t> workers(pool.size());
+        const size_t n_blocks
+            = (roots.size() + ROOTS_PER_BLOCK - 1) / ROOTS_PER_BLOCK;
+        std::vector<std::vector<parent_t>> kept_blocks(n_blocks);
+        pool.parallel_for(
+            n_blocks,
+            [&](size_t block, unsigned int w) -> void
+            {
+                worker_t& worker = workers[w];
+                std::vector<parent_t>& kept_block = kept_blocks[block];
+                const size_t b1 = std::min(
+                    (block+1) * ROOTS_PER_BLOCK, roots.size()
+                );
+                for (size_t b=block*ROOTS_PER_BLOCK; b<b1; ++b){
+                    worker.events.clear();
+                    simulate_cluster(
+                        roots[b], history_key(seed, b), process, kernel,
+                        magnitudes, worker.events, worker.generation,
+                        worker.offspring, t0
+                    );
+                    for (const parent_t& e : worker.events){
+                        if (expected_offspring(e.f, process)
+                            * kernel.survival(t0 - e.t)
+                            > options.init_tolerance)
+                        {
+                            kept_block.emplace_back(e.t, e.M, e.f);
+                        }
+                    }
+                }
+            }
+        );
+
+        std::vector<parent_t> kept;
+        for (const std::vector<parent_t>& kept_block : kept_blocks)
+            kept.insert(kept.end(), kept_block.begin(), kept_block.end());
+        t.resize(kept.size());
+        f.resize(kept.size());
+        for (size_t i=0; i<kept.size(); ++i){
+            t[i] = kept[i].t;
+            f[i] = kept[i].f;
+        }
+    });
+}
+
+
+/*
+ * Instantiations for the magnitude distributions and sinks:
+ */
+#define ETASCATGEN_INSTANTIATE(magnitudes_t, sink_t) \
+    template void generate_cluster<magnitudes_t, sink_t>( \
+        const Process_M_t&, const magnitudes_t&, size_t, \
+        const GenerationOptions&, sink_t& \
+    );
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, CountSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, CountSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, CountSink)
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, WindowSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, WindowSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, WindowSink)
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, AutoCountSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, AutoCountSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, AutoCountSink)
+#undef ETASCATGEN_INSTANTIATE
+
+#define ETASCATGEN_INSTANTIATE(magnitudes_t) \
+    template void stationary_history<magnitudes_t>( \
+        const Process_M_t&, const magnitudes_t&, size_t, \
+        const GenerationOptions&, std::vector<Time>&, std::vector<double>& \
+    );
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes)
+ETASCATGEN_INSTANTIATE(MagnitudeTable)
+#undef ETASCATGEN_INSTANTIATE
+
+}
@@ -0,0 +1,241 @@
+/*
+ * ETAS catalog generator with a sum-of-exponentials approximation of
+ * the modified Omori kernel.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/sumexp.hpp>
+#include <etascatgen/eventstream.hpp>
+#include <etascatgen/exponential.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <etascatgen/pipeline.hpp>
+#include <etascatgen/sink.hpp>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace etascatgen {
+
+/*
+ * Maximum relative error of the approximation on a logarithmically
+ * spaced grid of x in [0, horizon]:
+ */
+static double max_relative_error(
+    const ExponentialSum& sum,
+    double p,
+    double horizon
+)
+{
+    constexpr size_t NX = 2000;
+    const double lx_max = std::log1p(horizon);
+    double err = 0.0;
+    for (size_t i=0; i<=NX; ++i){
+        const double x = std::expm1((lx_max * i) / NX);
+        double approx = 0.0;
+        for (size_t j=0; j<sum.w.size(); ++j)
+            approx += sum.w[j] * std::exp(-sum.lambda[j] * x);
+        const double exact = std::pow(1.0 + x, -p);
+        err = std::max(err, std::abs(approx - exact) / exact);
+    }
+    return err;
+}
+
+
+ExponentialSum fit_exponential_sum(double p, double horizon, double rtol)
+{
+    if (rtol <= 0.0 || rtol >= 1.0)
+        throw std::runtime_error("Kernel tolerance needs to be in (0,1).");
+    if (horizon <= 0.0)
+        throw std::runtime_error("Kernel horizon needs to be positive.");
+
+    /*
+     * With l = exp(u), the integrand in u is
+     *    exp(p*u - exp(u) * (1 + x)) / Gamma(p)
+     * which decays double-exponentially for large u and like
+     * exp(p*u) for small u. The lower cutoff is chosen such that the
+     * omitted part is a fraction rtol of the kernel at x = horizon.
+     * The trapezoidal rule converges exponentially in 1/h for this
+     * analytic integrand (error ~ exp(-pi^2 / h)). Each refinement
+     * shrinks h and extends the lower cutoff. The initial choice meets
+     * the tolerance for common parameters, and MAX_REFINE refinements
+     * reduce h by a factor of about 90, so that a fit that does not
+     * converge by then indicates a numerical problem.
+     */
+    constexpr int MAX_REFINE = 20;
+    const double gamma_p = std::tgamma(p);
+    double u_min = (std::log(rtol * p * gamma_p) / p) - std::log1p(horizon);
+    const double u_max = std::log(p + 50.0);
+    double h = std::numbers::pi * std::numbers::pi / std::log(10.0 / rtol);
+
+    ExponentialSum sum;
+    for (int iter=0; iter<=MAX_REFINE; ++iter){
+        sum.w.clear();
+        sum.lambda.clear();
+        for (double u=u_max; u>=u_min; u-=h){
+            sum.lambda.push_back(std::exp(u));
+            sum.w.push_back(h * std::exp(p * u - std::exp(u)) / gamma_p);
+        }
+        sum.error = max_relative_error(sum, p, horizon);
+        if (sum.error <= rtol)
+            break;
+        h *= 0.8;
+        u_min -= 1.0;
+    }
+    if (!(sum.error <= rtol)){
+        std::ostringstream msg;
+        msg << "The sum of exponentials does not reach the kernel "
+               "tolerance " << rtol << " for p = " << p << " and the "
+               "kernel horizon " << horizon << " (maximum relative "
+               "error: " << sum.error << ").";
+        throw std::runtime_error(msg.str());
+    }
+    return sum;
+}
+
+
+template<typename magnitudes_t, typename sink_t>
+void generate_exponential_sum(
+    const Process_M_t& process,
+    const magnitudes_t& magnitudes,
+    size_t seed,
+    const GenerationOptions& options,
+    GenerationInfo& info,
+    sink_t& sink
+)
+{
+    ExponentialSum sum = fit_exponential_sum(
+        process.p,
+        options.kernel_horizon,
+        options.kernel_rtol
+    );
+    info.kernel_error = sum.error;
+    info.kernel_terms = sum.w.size();
+
+    /*
+     * In physical units, the kernel of an event of magnitude M is
+     *    f(M) * K / (t + c) ** p
+     *    = f(M) * FK * (Tref / c) ** p * (1 + t / c) ** (-p)
+     * so that the event excites term j by
+     *    f(M) * FK * (Tref / c) ** p * w[j]
+     * which subsequently decays at rate lambda[j] / c.
+     */
+    const size_t J = sum.w.size();
+    const Frequency FK_c
+        = process.FK * std::pow(process.Tref / process.c, process.p);
+    std::vector<Frequency> a(J);
+    std::vector<Frequency> r(J);
+    for (size_t j=0; j<J; ++j){
+        a[j] = FK_c * sum.w[j];
+        r[j] = sum.lambda[j] / process.c;
+    }
+
+    /* Current intensity of each term: */
+    std::vector<Frequency> x(J, 0.0 * bu::si::hertz);
+
+    /* Init the RNG of the thinning, and the background and magnitudes: */
+    RandomPipeline rng(
+        seed, options.engine, options.rng_thread, options.bit_source
+    );
+    EventStream<magnitudes_t> events(process, magnitudes, seed);
+
+    /* Time and magnitude of the current event: */
+    Time t = 0.0 * bu::si::seconds;
+    double M = std::numeric_limits<double>::quiet_NaN();
+
+    /* The next background event: */
+    Time next_bg = events.next_background();
+
+    /*
+     * The loop body. Since the triggered intensity decreases between
+     * events, its current value bounds it until the next event, and
+     * the next triggered event follows from thinning (Ogata, 1981).
+     * The background events are superposed, and the thinning restarts
+     * from each of them.
+     */
+    auto decay = [&](Time dt) -> Frequency
+    {
+        Frequency lambda = 0.0 * bu::si::hertz;
+        for (size_t j=0; j<J; ++j){
+            x[j] *= std::exp(-r[j] * dt);
+            lambda += x[j];
+        }
+        return lambda;
+    };
+    auto next_event = [&]()
+    {
+        Frequency bound = 0.0 * bu::si::hertz;
+        for (size_t j=0; j<J; ++j)
+            bound += x[j];
+        while (true){
+            const Time t_cand = t + exponential(rng) / bound;
+            if (!(t_cand < next_bg)){
+                /* Background event: */
+                decay(next_bg - t);
+                t = next_bg;
+                next_bg = events.next_background();
+                break;
+            }
+            const Frequency lambda = decay(t_cand - t);
+            t = t_cand;
+            if (uniform_0_1(rng()) * bound <= lambda)
+                break;
+            bound = lambda;
+        }
+
+        /*
+         * Magnitude and excitation:
+         */
+        const magnitude_t m = events.next_magnitude();
+        M = m.M;
+        for (size_t j=0; j<J; ++j)
+            x[j] += m.f * a[j];
+    };
+
+    /*
+     * Burn-in and output:
+     */
+    while (!sink.done()){
+        next_event();
+        sink.push(t, M);
+    }
+}
+
+/*
+ * Instantiations for the magnitude distributions and sinks:
+ */
+#define ETASCATGEN_INSTANTIATE(magnitudes_t, sink_t) \
+    template void generate_exponential_sum<magnitudes_t, sink_t>( \
+        const Process_M_t&, const magnitudes_t&, size_t, \
+        const GenerationOptions&, GenerationInfo&, sink_t& \
+    );
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, CountSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, CountSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, CountSink)
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, WindowSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, WindowSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, WindowSink)
+ETASCATGEN_INSTANTIATE(GutenbergRichterMagnitudes, AutoCountSink)
+ETASCATGEN_INSTANTIATE(TaperedGutenbergRichterMagnitudes, AutoCountSink)
+ETASCATGEN_INSTANTIATE(MagnitudeTable, AutoCountSink)
+#undef ETASCATGEN_INSTANTIATE
+
+}
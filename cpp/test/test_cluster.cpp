@@ -0,0 +1,128 @@
+/*
+ * Tests of the cluster simulation.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/cluster.hpp>
+#include <etascatgen/kernel.hpp>
+#include <etascatgen/magnitude.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using etascatgen::Time;
+namespace bu = boost::units;
+
+
+/*
+ * Truncating a cluster at t_end must not change the events before
+ * t_end: Each event keeps its random numbers regardless of how many of
+ * the events of its generation are discarded.
+ */
+static bool truncation_keeps_events(etascatgen::Kernel kernel_type)
+{
+    using namespace etascatgen;
+    constexpr double YEAR = 365.25 * 86400.0;
+    constexpr double Mmin = 3.0;
+    constexpr double Mmax = 8.0;
+    const double beta = std::log(10.0);
+    const double alpha = 0.8 * beta;
+
+    GutenbergRichterMagnitudes magnitudes(Mmin, Mmax, beta, alpha);
+    const Frequency mu_0 = 50.0 / YEAR / bu::si::seconds;
+    const Process_M_t process(
+        mu_0, 1.0 * bu::si::seconds, 1e-4 * YEAR * bu::si::seconds,
+        beta, alpha, 1.2, Mmin, Mmax, 0.9,
+        magnitudes.mean_productivity(), BackgroundRate(mu_0)
+    );
+    GenerationOptions options;
+    options.kernel = kernel_type;
+    options.kernel_tau = 0.1 * YEAR;
+    if (kernel_type == Kernel::custom){
+        options.kernel_tau = 1e4;
+        options.kernel_function = [](double x) -> double
+        {
+            return std::pow(1.0 + x, -1.2) * (x < 1e4);
+        };
+    }
+
+    bool success = true;
+    with_kernel(process, options, [&](const auto& kernel)
+    {
+        auto earlier = [](const event_t& e0, const event_t& e1) -> bool
+        {
+            return e0.t < e1.t;
+        };
+        std::vector<event_t> full, truncated;
+        std::vector<parent_t> generation, offspring;
+        for (uint64_t b=0; b<20; ++b){
+            const parent_t root(0.0 * bu::si::seconds, 6.5,
+                                magnitudes.draw(0.99).f);
+            full.clear();
+            simulate_cluster(
+                root, cluster_key(1234, b), process, kernel, magnitudes,
+                full, generation, offspring, INFINITE_TIME
+            );
+            std::sort(full.begin(), full.end(), earlier);
+
+            for (double t_end : {1e-3, 1e-2, 0.1, 1.0}){
+                const Time T = t_end * YEAR * bu::si::seconds;
+                truncated.clear();
+                simulate_cluster(
+                    root, cluster_key(1234, b), process, kernel, magnitudes,
+                    truncated, generation, offspring, T
+                );
+                std::sort(truncated.begin(), truncated.end(), earlier);
+                const size_t n = std::lower_bound(
+                    full.begin(), full.end(), event_t(T, 0.0), earlier
+                ) - full.begin();
+                bool equal = (truncated.size() == n);
+                for (size_t i=0; equal && i<n; ++i)
+                    equal = (truncated[i].t == full[i].t)
+                            && (truncated[i].M == full[i].M);
+                if (!equal){
+                    std::printf(
+                        "Cluster %lu truncated at %g yr: %lu events differ "
+                        "from the %lu events of the full cluster.\n",
+                        static_cast<unsigned long>(b), t_end,
+                        static_cast<unsigned long>(truncated.size()),
+                        static_cast<unsigned long>(n)
+                    );
+                    success = false;
+                }
+            }
+        }
+    });
+    return success;
+}
+
+
+int main()
+{
+    bool success = true;
+    for (etascatgen::Kernel kernel : {etascatgen::Kernel::omori,
+                                      etascatgen::Kernel::exponential,
+                                      etascatgen::Kernel::tapered_omori,
+                                      etascatgen::Kernel::custom})
+    {
+        success &= truncation_keeps_events(kernel);
+    }
+    return success ? 0 : 1;
+}
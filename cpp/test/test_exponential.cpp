@@ -0,0 +1,122 @@
+/*
+ * Tests of the exponential ziggurat.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/engine.hpp>
+#include <etascatgen/exponential.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using etascatgen::Xoshiro256pp;
+
+/*
+ * Number of variates per test, and the critical values of the tests
+ * at a significance of about 1e-3 per statistic:
+ */
+constexpr size_t N = 1 << 21;
+constexpr double KS_CRITICAL = 1.95;
+constexpr double Z_CRITICAL = 3.3;
+
+
+/*
+ * Compare the variates E to the unit exponential distribution by the
+ * Kolmogorov-Smirnov statistic, the first three moments, and the
+ * probability of the tail beyond the base layer of the ziggurat:
+ */
+static bool is_exponential(std::vector<double> E, const std::string& name)
+{
+    const double n = E.size();
+    bool success = true;
+    auto check = [&](const char* what, double statistic, double critical)
+    {
+        if (!(std::abs(statistic) < critical)){
+            std::printf("%s: %s statistic %g exceeds %g.\n", name.c_str(),
+                        what, statistic, critical);
+            success = false;
+        }
+    };
+
+    std::sort(E.begin(), E.end());
+    double D = 0.0;
+    for (size_t i=0; i<E.size(); ++i){
+        const double F = -std::expm1(-E[i]);
+        D = std::max(D, std::max(F - i / n, (i + 1) / n - F));
+    }
+    check("Kolmogorov-Smirnov", D * std::sqrt(n), KS_CRITICAL);
+
+    /* The moments E[x^k] = k! with variances (2k)! - (k!)^2: */
+    double m1 = 0.0, m2 = 0.0, m3 = 0.0;
+    for (double x : E){
+        m1 += x;
+        m2 += x * x;
+        m3 += x * x * x;
+    }
+    check("First moment", (m1 / n - 1.0) / std::sqrt(1.0 / n), Z_CRITICAL);
+    check("Second moment", (m2 / n - 2.0) / std::sqrt(20.0 / n), Z_CRITICAL);
+    check("Third moment", (m3 / n - 6.0) / std::sqrt(684.0 / n), Z_CRITICAL);
+
+    const double R = etascatgen::ExponentialZiggurat::R;
+    const double P_tail = std::exp(-R);
+    const double n_tail = E.end() - std::upper_bound(E.begin(), E.end(), R);
+    check("Tail", (n_tail - n * P_tail) / std::sqrt(n * P_tail), Z_CRITICAL);
+    return success;
+}
+
+
+int main()
+{
+    bool success = true;
+
+    /* Scalar ziggurat: */
+    {
+        Xoshiro256pp rng(2741);
+        std::vector<double> E(N);
+        for (double& e : E)
+            e = etascatgen::exponential(rng);
+        success &= is_exponential(E, "Scalar ziggurat");
+    }
+
+    /* Block ziggurat, the way the samplers use it: */
+    {
+        constexpr size_t BLOCK = 512;
+        Xoshiro256pp rng(9127);
+        std::vector<double> E(N);
+        std::vector<uint64_t> w(BLOCK);
+        for (size_t k=0; k<N; k+=BLOCK){
+            rng.fill(w.data(), BLOCK);
+            etascatgen::exponential_block(w.data(), &E[k], BLOCK, rng);
+        }
+        success &= is_exponential(E, "Block ziggurat");
+    }
+
+    /* The inversion that the ziggurat replaces, as a control: */
+    {
+        Xoshiro256pp rng(5519);
+        std::vector<double> E(N);
+        for (double& e : E)
+            e = -std::log(etascatgen::uniform_0_1(rng()));
+        success &= is_exponential(E, "Inversion");
+    }
+
+    return success ? 0 : 1;
+}
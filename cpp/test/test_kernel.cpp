@@ -0,0 +1,96 @@
+/*
+ * Tests of the time kernels.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/kernel.hpp>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+using etascatgen::Time;
+namespace bu = boost::units;
+
+
+static etascatgen::Process_M_t make_process()
+{
+    using namespace etascatgen;
+    const Frequency mu_0 = 1e-6 / bu::si::seconds;
+    return Process_M_t(
+        mu_0, 1.0 * bu::si::seconds, 100.0 * bu::si::seconds,
+        std::log(10.0), 0.8 * std::log(10.0), 1.2, 3.0, 8.0, 0.8, 1.0,
+        BackgroundRate(mu_0)
+    );
+}
+
+
+/*
+ * The acceptance of a smooth kernel stays within (0, 1] everywhere:
+ */
+static bool smooth_kernel_accepts()
+{
+    const etascatgen::Process_M_t process(make_process());
+    etascatgen::ThinnedKernel kernel(process, 1e4, [](double x) -> double
+    {
+        return std::pow(1.0 + x, -1.2);
+    });
+    for (size_t i=0; i<100000; ++i){
+        const double x = 1e-6 * std::pow(1e4 / 1e-6, i / 100000.0);
+        const double p = kernel.acceptance(x * process.c);
+        if (!(p > 0.0) || !(p <= 1.0)){
+            std::printf("Acceptance %g of the smooth kernel at x = %g.\n",
+                        p, x);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+ * A peak much narrower than the grid of its envelope segment exceeds
+ * the envelope. Its candidates have to raise an error rather than be
+ * accepted unconditionally:
+ */
+static bool narrow_peak_throws()
+{
+    constexpr double X_PEAK = 0.3000123;
+    constexpr double WIDTH = 1e-7;
+    const etascatgen::Process_M_t process(make_process());
+    etascatgen::ThinnedKernel kernel(process, 10.0, [](double x) -> double
+    {
+        const double z = (x - X_PEAK) / WIDTH;
+        return std::pow(1.0 + x, -1.2) + 100.0 * std::exp(-z * z);
+    });
+    try {
+        kernel.acceptance(X_PEAK * process.c);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    std::printf("The narrow peak did not exceed its envelope.\n");
+    return false;
+}
+
+
+int main()
+{
+    bool success = smooth_kernel_accepts();
+    success &= narrow_peak_throws();
+    return success ? 0 : 1;
+}
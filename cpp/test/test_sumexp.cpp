@@ -0,0 +1,97 @@
+/*
+ * Tests of the sum-of-exponentials approximation of the Omori kernel.
+ *
+ * Author: Malte J. Ziebarth (mjz.science@fmvkb.de)
+ *
+ * Copyright (C) 2025 Malte J. Ziebarth
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/collection/eupl/eupl-text-eupl-12
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the Licence is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the Licence for the specific language governing permissions and
+ * limitations under the Licence.
+ */
+
+#include <etascatgen/sumexp.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+
+/*
+ * The fit reaches the tolerance over the range of Omori exponents,
+ * horizons, and tolerances, which we verify independently on a grid
+ * offset from the one used by the fit:
+ */
+static bool fit_reaches_tolerance()
+{
+    constexpr double P[] = {1.01, 1.05, 1.1, 1.2, 1.5, 2.0, 3.0};
+    constexpr double HORIZON[] = {1e2, 1e4, 1e6, 1e8, 1e9};
+    constexpr double RTOL[] = {1e-2, 1e-3, 1e-4, 1e-6, 1e-8};
+    constexpr size_t NX = 3001;
+    bool success = true;
+    for (double p : P){
+        for (double horizon : HORIZON){
+            for (double rtol : RTOL){
+                etascatgen::ExponentialSum sum;
+                try {
+                    sum = etascatgen::fit_exponential_sum(p, horizon, rtol);
+                } catch (const std::runtime_error& e) {
+                    std::printf("p = %g, horizon = %g, rtol = %g: %s\n",
+                                p, horizon, rtol, e.what());
+                    success = false;
+                    continue;
+                }
+                double err = 0.0;
+                const double lx_max = std::log1p(horizon);
+                for (size_t i=0; i<=NX; ++i){
+                    const double x = std::expm1((lx_max * i) / NX);
+                    double approx = 0.0;
+                    for (size_t j=0; j<sum.w.size(); ++j)
+                        approx += sum.w[j] * std::exp(-sum.lambda[j] * x);
+                    const double exact = std::pow(1.0 + x, -p);
+                    err = std::max(err, std::abs(approx - exact) / exact);
+                }
+                if (!(sum.error <= rtol) || !(err <= rtol)){
+                    std::printf("p = %g, horizon = %g, rtol = %g: error %g "
+                                "(reported %g).\n",
+                                p, horizon, rtol, err, sum.error);
+                    success = false;
+                }
+            }
+        }
+    }
+    return success;
+}
+
+
+/*
+ * A tolerance below the precision of double cannot be reached and has
+ * to raise an error rather than return the inaccurate fit:
+ */
+static bool unreachable_tolerance_throws()
+{
+    try {
+        etascatgen::fit_exponential_sum(1.1, 1e8, 1e-17);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    std::printf("The unreachable tolerance did not raise an error.\n");
+    return false;
+}
+
+
+int main()
+{
+    bool success = fit_reaches_tolerance();
+    success &= unreachable_tolerance_throws();
+    return success ? 0 : 1;
+}
@@ -17,4 +17,9 @@
 # See the Licence for the specific language governing permissions and
 # limitations under the Licence.
 
-from .backend import generate_catalog_M_t as generate_catalog_M_t
\ No newline at end of file
+from .backend import generate_catalog_M_t as generate_catalog_M_t
+from .backend import generate_catalog_M_t_window as \
+    generate_catalog_M_t_window
+from .backend import generate_ensemble_M_t_window as \
+    generate_ensemble_M_t_window
+from .backend import generate_sweep_M_t as generate_sweep_M_t
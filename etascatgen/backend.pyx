@@ -18,8 +18,122 @@
 # limitations under the Licence.
 
 from cyantities.quantity cimport Quantity, QuantityWrapper
+from libcpp.vector cimport vector
+from libc.stdint cimport uint64_t
+from libc.stdlib cimport free
+from cpython.pycapsule cimport PyCapsule_IsValid, PyCapsule_GetPointer
+from cython.view cimport array as cvarray
+from numpy.random cimport bitgen_t
+from contextlib import nullcontext
+import numpy as np
+
+cdef extern from "etascatgen/arena.hpp" namespace "etascatgen" nogil:
+    cdef cppclass CatalogArena:
+        CatalogArena(size_t chunk_size) except+
+        size_t size()
+        size_t n_chunks()
+        size_t chunk_length(size_t k)
+        double* release_t(size_t k) except+
+        double* release_M(size_t k) except+
+        void copy_to(QuantityWrapper& Mi, QuantityWrapper& ti) except+
+
+    cdef cppclass CatalogEnsemble:
+        CatalogEnsemble(size_t n_members, size_t chunk_size) except+
+        size_t n_members()
+        CatalogArena& member(size_t k) except+
+        size_t size()
+        vector[size_t] offsets() except+
+        void copy_to(QuantityWrapper& Mi, QuantityWrapper& ti) except+
+
 
 cdef extern from "etascatgen/etascatgen.hpp" namespace "etascatgen" nogil:
+    cdef enum class Method:
+        sequential
+        cluster
+        exponential_sum
+
+    cdef enum class Queue:
+        binary
+        dary
+        radix
+
+    cdef enum class Sampling:
+        clock
+        count
+
+    cdef enum class Kernel:
+        omori
+        exponential
+        tapered_omori
+        truncated_omori
+
+    cdef enum class Magnitudes:
+        gutenberg_richter
+        tapered_gutenberg_richter
+        table
+
+    cdef enum class Background:
+        constant
+        piecewise_constant
+        piecewise_linear
+
+    cdef enum class Initialization:
+        empty
+        stationary
+
+    cdef enum class Engine:
+        mt19937_64
+        xoshiro256pp
+        pcg64
+        philox
+
+    cdef cppclass BitSource:
+        void* state
+        uint64_t (*next_uint64)(void*) nogil
+
+    cdef cppclass GenerationOptions:
+        Method method
+        Queue queue
+        Sampling sampling
+        Kernel kernel
+        double kernel_tau
+        Magnitudes magnitudes
+        double corner_magnitude
+        vector[double] magnitude_table
+        vector[double] magnitude_weights
+        Background background
+        vector[double] background_times
+        vector[double] background_factors
+        double kernel_rtol
+        double kernel_horizon
+        Initialization initialization
+        double init_window
+        double init_tolerance
+        bint auto_burn_in
+        size_t burn_in_window
+        double burn_in_tolerance
+        double retire_tolerance
+        double aggregate_age
+        double aggregate_width
+        Engine engine
+        BitSource bit_source
+        bint rng_thread
+        unsigned int threads
+
+    cdef cppclass GenerationInfo:
+        double kernel_error
+        size_t kernel_terms
+        size_t burn_in_events
+        bint burn_in_converged
+        double burn_in_rate_ratio
+        double burn_in_branching
+        double burn_in_queue_size
+        size_t retired_parents
+        double retired_offspring
+        size_t parent_capacity
+        size_t joined_parents
+        size_t super_parents
+
     void ETAS_generate_catalog_M_t(
         const QuantityWrapper& mu_0,
         double Mmin,
@@ -31,12 +145,409 @@ cdef extern from "etascatgen/etascatgen.hpp" namespace "etascatgen" nogil:
         double offspring_fraction,
         size_t N_skip,
         size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
         QuantityWrapper& Mi,
         QuantityWrapper& ti
     ) except+
 
+    void ETAS_generate_catalog_M_t_window(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogArena& catalog
+    ) except+
+
+    void ETAS_generate_ensemble_M_t_window(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        const vector[size_t]& seeds,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogEnsemble& ensemble
+    ) except+
+
+    void ETAS_generate_forked_ensemble_M_t_window(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        size_t seed,
+        const vector[size_t]& seeds,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogEnsemble& ensemble
+    ) except+
+
+    void ETAS_generate_sweep_M_t(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        const vector[double]& alpha,
+        const vector[double]& p,
+        QuantityWrapper& c,
+        const vector[double]& offspring_fraction,
+        size_t N_skip,
+        size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        QuantityWrapper& Mi,
+        QuantityWrapper& ti
+    ) except+
+
+    vector[double] to_seconds(QuantityWrapper& t) except+
+
+
+
+
+
+
+cdef GenerationOptions _generation_options(
+        str method,
+        str queue,
+        str sampling,
+        unsigned int threads,
+        str kernel,
+        double kernel_tau,
+        str magnitudes,
+        double corner_magnitude,
+        magnitude_table,
+        magnitude_weights,
+        str background,
+        Quantity background_times,
+        background_factors,
+        double kernel_rtol,
+        double kernel_horizon,
+        str initialization,
+        Quantity init_window,
+        double init_tolerance,
+        double retire_tolerance,
+        double aggregate_age,
+        double aggregate_width,
+        str engine,
+        bint rng_thread
+    ) except *:
+    """
+    Translate the keyword arguments of the generation functions to the
+    C++ generation options.
+    """
+    cdef GenerationOptions options
+    if method == "sequential":
+        options.method = Method.sequential
+    elif method == "cluster":
+        options.method = Method.cluster
+    elif method == "exponential_sum":
+        options.method = Method.exponential_sum
+    else:
+        raise ValueError("Unknown method '" + method + "'.")
+    if queue == "binary":
+        options.queue = Queue.binary
+    elif queue == "dary":
+        options.queue = Queue.dary
+    elif queue == "radix":
+        options.queue = Queue.radix
+    else:
+        raise ValueError("Unknown queue '" + queue + "'.")
+    if sampling == "clock":
+        options.sampling = Sampling.clock
+    elif sampling == "count":
+        options.sampling = Sampling.count
+    else:
+        raise ValueError("Unknown sampling '" + sampling + "'.")
+    if kernel == "omori":
+        options.kernel = Kernel.omori
+    elif kernel == "exponential":
+        options.kernel = Kernel.exponential
+    elif kernel == "tapered_omori":
+        options.kernel = Kernel.tapered_omori
+    elif kernel == "truncated_omori":
+        options.kernel = Kernel.truncated_omori
+    else:
+        raise ValueError("Unknown kernel '" + kernel + "'.")
+    options.kernel_tau = kernel_tau
+    if magnitudes == "gutenberg_richter":
+        options.magnitudes = Magnitudes.gutenberg_richter
+    elif magnitudes == "tapered_gutenberg_richter":
+        options.magnitudes = Magnitudes.tapered_gutenberg_richter
+    elif magnitudes == "table":
+        options.magnitudes = Magnitudes.table
+        if magnitude_table is None:
+            raise ValueError("The 'table' magnitudes require a "
+                             "magnitude_table.")
+        options.magnitude_table = [float(m) for m in magnitude_table]
+        if magnitude_weights is not None:
+            options.magnitude_weights = [float(w) for w in magnitude_weights]
+    else:
+        raise ValueError("Unknown magnitudes '" + magnitudes + "'.")
+    options.corner_magnitude = corner_magnitude
+    if background == "constant":
+        options.background = Background.constant
+    elif background in ("piecewise_constant", "piecewise_linear"):
+        if background == "piecewise_constant":
+            options.background = Background.piecewise_constant
+        else:
+            options.background = Background.piecewise_linear
+        if background_times is None or background_factors is None:
+            raise ValueError("The '" + background + "' background requires "
+                             "background_times and background_factors.")
+        options.background_times = to_seconds(background_times.wrapper())
+        options.background_factors = [float(m) for m in background_factors]
+    else:
+        raise ValueError("Unknown background '" + background + "'.")
+    options.threads = threads
+    options.kernel_rtol = kernel_rtol
+    options.kernel_horizon = kernel_horizon
+    if initialization == "empty":
+        options.initialization = Initialization.empty
+    elif initialization == "stationary":
+        options.initialization = Initialization.stationary
+        if init_window is None:
+            raise ValueError("The 'stationary' initialization requires an "
+                             "init_window.")
+        options.init_window = to_seconds(init_window.wrapper())[0]
+    else:
+        raise ValueError("Unknown initialization '" + initialization + "'.")
+    options.init_tolerance = init_tolerance
+    if not retire_tolerance >= 0.0:
+        raise ValueError("retire_tolerance needs to be non-negative.")
+    options.retire_tolerance = retire_tolerance
+    if not 0.0 <= aggregate_age < float('inf'):
+        raise ValueError("aggregate_age needs to be non-negative.")
+    options.aggregate_age = aggregate_age
+    if not 0.0 < aggregate_width <= 1.0:
+        raise ValueError("aggregate_width needs to be in (0, 1].")
+    options.aggregate_width = aggregate_width
+    if engine == "mt19937_64":
+        options.engine = Engine.mt19937_64
+    elif engine == "xoshiro256pp":
+        options.engine = Engine.xoshiro256pp
+    elif engine == "pcg64":
+        options.engine = Engine.pcg64
+    elif engine == "philox":
+        options.engine = Engine.philox
+    else:
+        raise ValueError("Unknown engine '" + engine + "'.")
+    options.rng_thread = rng_thread
+    return options
+
+
+cdef object _bit_generator(seed):
+    """
+    The NumPy BitGenerator behind `seed`, which is an integer (None), a
+    numpy.random.Generator, or a numpy.random.BitGenerator.
+    """
+    if isinstance(seed, np.random.Generator):
+        return seed.bit_generator
+    if isinstance(seed, np.random.BitGenerator):
+        return seed
+    return None
+
+
+cdef size_t _attach_bit_generator(
+        bit_generator,
+        GenerationOptions& options
+    ) except *:
+    """
+    Let the random number engine of the options draw from the C
+    interface of the BitGenerator, and return the seed of the remaining
+    random streams, which is the next word of the BitGenerator. The
+    lock of the BitGenerator needs to be held until the generation has
+    finished.
+    """
+    cdef bitgen_t* bitgen
+    if options.rng_thread:
+        raise ValueError(
+            "rng_thread cannot be combined with a BitGenerator, whose "
+            "state would advance by an undetermined number of words."
+        )
+    capsule = bit_generator.capsule
+    if not PyCapsule_IsValid(capsule, "BitGenerator"):
+        raise ValueError("Invalid BitGenerator capsule.")
+    bitgen = <bitgen_t*>PyCapsule_GetPointer(capsule, "BitGenerator")
+    options.bit_source.state = bitgen.state
+    options.bit_source.next_uint64 = bitgen.next_uint64
+    return bitgen.next_uint64(bitgen.state)
+
+
+cdef dict _info_dict(const GenerationInfo& info, bint burn_in):
+    """
+    The diagnostics of the generation as a dictionary, including those of
+    the automatic burn-in if `burn_in` is True.
+    """
+    diagnostics = {
+        'kernel_error' : info.kernel_error,
+        'kernel_terms' : info.kernel_terms,
+        'retired_parents' : info.retired_parents,
+        'retired_offspring' : info.retired_offspring,
+        'parent_capacity' : info.parent_capacity,
+        'joined_parents' : info.joined_parents,
+        'super_parents' : info.super_parents
+    }
+    if burn_in:
+        diagnostics.update({
+            'burn_in_events' : info.burn_in_events,
+            'burn_in_converged' : info.burn_in_converged,
+            'burn_in_rate_ratio' : info.burn_in_rate_ratio,
+            'burn_in_branching' : info.burn_in_branching,
+            'burn_in_queue_size' : info.burn_in_queue_size
+        })
+    return diagnostics
+
+
+cdef void _generate_catalog_M_t_nogil(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        size_t N_skip,
+        size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        QuantityWrapper& Mi,
+        QuantityWrapper& ti
+    ) except *:
+    """
+    ETAS_generate_catalog_M_t without holding the GIL.
+    """
+    with nogil:
+        ETAS_generate_catalog_M_t(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction,
+            N_skip, seed, options, info, Mi, ti
+        )
+
+
+cdef void _generate_catalog_M_t_window_nogil(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogArena& catalog
+    ) except *:
+    """
+    ETAS_generate_catalog_M_t_window without holding the GIL.
+    """
+    with nogil:
+        ETAS_generate_catalog_M_t_window(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, T0,
+            T1, seed, options, info, catalog
+        )
+
+
+cdef void _generate_ensemble_M_t_window_nogil(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        const vector[size_t]& seeds,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogEnsemble& ensemble
+    ) except *:
+    """
+    ETAS_generate_ensemble_M_t_window without holding the GIL.
+    """
+    with nogil:
+        ETAS_generate_ensemble_M_t_window(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, T0,
+            T1, seeds, options, info, ensemble
+        )
+
+
+cdef void _generate_forked_ensemble_M_t_window_nogil(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        const QuantityWrapper& c,
+        double offspring_fraction,
+        const QuantityWrapper& T0,
+        const QuantityWrapper& T1,
+        size_t seed,
+        const vector[size_t]& seeds,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        CatalogEnsemble& ensemble
+    ) except *:
+    """
+    ETAS_generate_forked_ensemble_M_t_window without holding the GIL.
+    """
+    with nogil:
+        ETAS_generate_forked_ensemble_M_t_window(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, T0,
+            T1, seed, seeds, options, info, ensemble
+        )
 
 
+cdef void _generate_sweep_M_t_nogil(
+        const QuantityWrapper& mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        const vector[double]& alpha,
+        const vector[double]& p,
+        QuantityWrapper& c,
+        const vector[double]& offspring_fraction,
+        size_t N_skip,
+        size_t seed,
+        const GenerationOptions& options,
+        GenerationInfo& info,
+        QuantityWrapper& Mi,
+        QuantityWrapper& ti
+    ) except *:
+    """
+    ETAS_generate_sweep_M_t without holding the GIL.
+    """
+    with nogil:
+        ETAS_generate_sweep_M_t(
+            mu_0, Mmin, Mmax, beta, alpha, p, c, offspring_fraction, N_skip,
+            seed, options, info, Mi, ti
+        )
 
 
 def generate_catalog_M_t(
@@ -49,27 +560,616 @@ def generate_catalog_M_t(
         double p,
         Quantity c,
         double offspring_fraction,
-        size_t N_skip,
-        size_t seed = 198372
+        N_skip,
+        seed = 198372,
+        str method = "sequential",
+        str queue = "radix",
+        str sampling = "clock",
+        unsigned int threads = 1,
+        str kernel = "omori",
+        double kernel_tau = 1e6,
+        str magnitudes = "gutenberg_richter",
+        double corner_magnitude = float('nan'),
+        magnitude_table = None,
+        magnitude_weights = None,
+        str background = "constant",
+        Quantity background_times = None,
+        background_factors = None,
+        double kernel_rtol = 1e-3,
+        double kernel_horizon = 1e8,
+        str initialization = "empty",
+        Quantity init_window = None,
+        double init_tolerance = 1e-6,
+        double retire_tolerance = 0.0,
+        double aggregate_age = 0.0,
+        double aggregate_width = 0.1,
+        str engine = "mt19937_64",
+        bint rng_thread = False,
+        burn_in_max = None,
+        size_t burn_in_window = 10000,
+        double burn_in_tolerance = 0.05,
+        bint return_info = False
     ):
+    """
+    Generate an ETAS catalog of N magnitudes and occurrence times.
+
+    The `method` selects the generation algorithm:
+     - 'sequential': generate the events one by one from a priority
+                     queue of the intensity components.
+     - 'cluster':    generate the catalog from the Poisson cluster
+                     representation of the Hawkes process. Both
+                     methods sample the same process but consume the
+                     random numbers differently, so the catalogs differ
+                     for the same seed.
+     - 'exponential_sum':
+                     approximate the Omori kernel by a sum of
+                     exponentials with maximum relative error
+                     `kernel_rtol` on the time interval
+                     [0, kernel_horizon * c], and simulate the resulting
+                     Markovian Hawkes process. Its memory does not grow
+                     with the number of active parents.
+
+    `queue` selects the priority queue of the 'sequential' method:
+     - 'binary': a binary heap (std::priority_queue).
+     - 'dary':   a cache-friendly 4-ary heap.
+     - 'radix':  a radix heap on the bit pattern of the occurrence times
+                 (fastest for large queues).
+    All queues yield the same catalog.
+
+    `sampling` selects how the 'sequential' method samples the
+    descendants of an event:
+     - 'clock': one at a time by advancing the event's transformed Omori
+                clock whenever the previous descendant occurs.
+     - 'count': draw the number of descendants once and produce their
+                times in increasing order (in blocks for events with many
+                descendants).
+
+    `kernel` selects the time kernel of the triggered intensity:
+     - 'omori':           the modified Omori law (t + c) ** -p.
+     - 'exponential':     exp(-t / c).
+     - 'tapered_omori':   the modified Omori law with its survival
+                          function tapered by exp(-t / tau).
+     - 'truncated_omori': the modified Omori law cut off at t = tau.
+    Here, tau = kernel_tau * c. All kernels are normalized, so that
+    `offspring_fraction` is the branching ratio for each of them. The
+    'exponential_sum' method supports only the 'omori' kernel.
+
+    `magnitudes` selects the magnitude distribution:
+     - 'gutenberg_richter': the Gutenberg-Richter law truncated to
+                            [Mmin, Mmax].
+     - 'tapered_gutenberg_richter':
+                            the tapered Gutenberg-Richter law with
+                            corner magnitude `corner_magnitude`,
+                            truncated to [Mmin, Mmax].
+     - 'table':             an empirical or binned magnitude-frequency
+                            table. The magnitudes `magnitude_table` are
+                            drawn with probabilities proportional to
+                            `magnitude_weights` (uniform if None) using
+                            an alias table.
+    The productivity is normalized to the offspring fraction for each
+    distribution.
+
+    `background` selects the time dependence of the background rate
+    mu(t) = mu_0 * m(t):
+     - 'constant':           m(t) = 1.
+     - 'piecewise_constant': m(t) = background_factors[k] from the knot
+                             background_times[k] to the next knot.
+     - 'piecewise_linear':   m(t) interpolates background_factors
+                             linearly between the knots.
+    Before the first and after the last knot, m(t) keeps the value at
+    that knot. The background events are drawn directly from mu(t), so
+    no events have to be discarded.
+
+    `initialization` selects the initial state of the 'sequential'
+    method:
+     - 'empty':      the process starts without any past events, so
+                     that the first events are not stationary (see
+                     `N_skip`).
+     - 'stationary': the process starts from a synthetic history over
+                     the time span `init_window` before t = 0, which is
+                     simulated in parallel from the cluster
+                     representation. Past events that are expected to
+                     have at most `init_tolerance` descendants after
+                     t = 0 are dropped.
+
+    `retire_tolerance` lets the 'sequential' method retire a parent
+    once its expected number of further descendants falls below it,
+    instead of keeping it until its next descendant. For Omori kernels
+    with p close to one, this bounds the number of parents held at
+    once. Each parent loses at most `retire_tolerance` descendants in
+    expectation, so that the branching ratio is biased low by at most
+    `retire_tolerance`.
+
+    `aggregate_age` (in units of c) lets the 'sequential' method hand
+    parents of that age over to a few aggregate 'super-parents', each
+    of which produces the further descendants of the parents with
+    nearby occurrence times from a combined Omori intensity. Parents
+    are combined if their times differ by at most `aggregate_width`
+    times their age, which bounds the relative error of the intensity
+    to about p * (p + 1) / 8 * aggregate_width**2. For Omori kernels
+    with p close to one, this bounds the number of parents held at
+    once without discarding descendants. Zero disables it.
+
+    `engine` selects the random number engine of the 'sequential' and
+    'exponential_sum' methods: 'mt19937_64', 'xoshiro256pp', 'pcg64',
+    or 'philox' (Philox4x64-10). The engines yield different catalogs
+    for the same seed.
+
+    If `rng_thread` is True, the 'sequential' and 'exponential_sum'
+    methods run their random number engine on a separate thread that
+    feeds the event loop through a ring buffer. The catalog is
+    identical to the one without it. The thread sleeps while the ring
+    buffer is full, so that it occupies a core only while producing.
+
+    `seed` is an integer or a numpy.random.Generator or BitGenerator.
+    Given the latter, its next 64 bit word seeds the random streams
+    of the background, the magnitudes, and the 'cluster' method, and
+    the 'sequential' and 'exponential_sum' methods draw the random
+    numbers of the triggering from it instead of `engine`. They are
+    drawn through the C interface of the BitGenerator in blocks of 512
+    words, without holding the GIL but holding the lock of the
+    BitGenerator. Its state advances by the words drawn, so that
+    consecutive calls continue its stream. This excludes `rng_thread`.
+
+    `N_skip` is the number of events discarded before the catalog
+    starts. If N_skip is 'auto', the burn-in is monitored in windows of
+    `burn_in_window` events, each window twice as long as the previous
+    one, and ends after two consecutive windows in which the event rate
+    relative to the stationary rate mu_0 / (1 - offspring_fraction) and
+    the fraction of triggered events relative to offspring_fraction
+    deviate by less than `burn_in_tolerance`. The burn-in is limited to
+    `burn_in_max` events (default: 100 * N). The fraction of triggered
+    events is available for the 'sequential' method only.
+
+    `threads` sets the number of threads used by the 'cluster' method
+    (0: all cores). Its random numbers are keyed by the seed and the
+    identity of each event, so the catalog is bitwise identical for any
+    number of threads.
+
+    If `return_info` is True, a dictionary of diagnostics is returned
+    as a third value. It contains the achieved relative error
+    ('kernel_error') and number of terms ('kernel_terms') of the
+    'exponential_sum' method, the number of parents retired under
+    `retire_tolerance` ('retired_parents') and an estimate of the number
+    of descendants discarded with them ('retired_offspring'), and the
+    peak number of parents held at once ('parent_capacity'), and the
+    number of parents handed over to super-parents ('joined_parents')
+    and the peak number of super-parents ('super_parents'). With
+    N_skip='auto', it further contains
+    the number of events discarded ('burn_in_events'), whether the
+    burn-in converged before reaching burn_in_max ('burn_in_converged'),
+    and the statistics of the last burn-in window: the rate ratio
+    ('burn_in_rate_ratio'), the fraction of triggered events
+    ('burn_in_branching'), and the number of active parents at its end
+    ('burn_in_queue_size').
+    """
     assert mu_0._is_scalar
 
+    cdef GenerationOptions options = _generation_options(
+        method, queue, sampling, threads, kernel, kernel_tau, magnitudes,
+        corner_magnitude, magnitude_table, magnitude_weights, background,
+        background_times, background_factors, kernel_rtol, kernel_horizon,
+        initialization, init_window, init_tolerance, retire_tolerance,
+        aggregate_age, aggregate_width, engine, rng_thread
+    )
+    cdef size_t N_skip_max
+    if isinstance(N_skip, str):
+        if N_skip != "auto":
+            raise ValueError("N_skip needs to be an integer or 'auto'.")
+        options.auto_burn_in = True
+        options.burn_in_window = burn_in_window
+        options.burn_in_tolerance = burn_in_tolerance
+        N_skip_max = 100 * N if burn_in_max is None else burn_in_max
+    else:
+        N_skip_max = N_skip
+    cdef GenerationInfo info
+
     cdef Quantity Mi = Quantity.zeros(N, '1')
     cdef Quantity ti = Quantity.zeros(N, 's')
 
-    ETAS_generate_catalog_M_t(
+    cdef size_t seed_
+    bit_generator = _bit_generator(seed)
+    lock = nullcontext() if bit_generator is None else bit_generator.lock
+    with lock:
+        if bit_generator is None:
+            seed_ = seed
+        else:
+            seed_ = _attach_bit_generator(bit_generator, options)
+        _generate_catalog_M_t_nogil(
+            mu_0.wrapper(),
+            Mmin,
+            Mmax,
+            beta,
+            alpha,
+            p,
+            c.wrapper(),
+            offspring_fraction,
+            N_skip_max,
+            seed_,
+            options,
+            info,
+            Mi.wrapper(),
+            ti.wrapper()
+        )
+
+    if return_info:
+        return Mi, ti, _info_dict(info, options.auto_burn_in)
+    return Mi, ti
+
+
+
+cdef object _release_chunk(double* data, size_t n):
+    """
+    Hand the ownership of a malloc'ed chunk of the catalog arena to a
+    NumPy array without copying.
+    """
+    cdef cvarray arr = cvarray(
+        shape=(n,), itemsize=sizeof(double), format='d', mode='c',
+        allocate_buffer=False
+    )
+    arr.data = <char*>data
+    arr.callback_free_data = free
+    return np.asarray(arr)
+
+
+def generate_catalog_M_t_window(
+        Quantity T0,
+        Quantity T1,
+        Quantity mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        Quantity c,
+        double offspring_fraction,
+        seed = 198372,
+        bint chunks = False,
+        size_t chunk_size = 65536,
+        str method = "sequential",
+        str queue = "radix",
+        str sampling = "clock",
+        unsigned int threads = 1,
+        str kernel = "omori",
+        double kernel_tau = 1e6,
+        str magnitudes = "gutenberg_richter",
+        double corner_magnitude = float('nan'),
+        magnitude_table = None,
+        magnitude_weights = None,
+        str background = "constant",
+        Quantity background_times = None,
+        background_factors = None,
+        double kernel_rtol = 1e-3,
+        double kernel_horizon = 1e8,
+        str initialization = "empty",
+        Quantity init_window = None,
+        double init_tolerance = 1e-6,
+        double retire_tolerance = 0.0,
+        double aggregate_age = 0.0,
+        double aggregate_width = 0.1,
+        str engine = "mt19937_64",
+        bint rng_thread = False,
+        bint return_info = False
+    ):
+    """
+    Generate all events of an ETAS catalog within the time window
+    [T0, T1).
+
+    The process starts at t = 0, and the events before T0 serve as the
+    burn-in without being stored. The catalog grows in chunks of
+    `chunk_size` events that are never reallocated. If `chunks` is
+    False, the magnitudes and times are returned as one contiguous
+    array each (Mi, ti). Otherwise, a list of (Mi, ti) pairs is returned,
+    one per chunk, which take over the chunks without copying.
+
+    The keyword arguments steering the generation are those of
+    `generate_catalog_M_t`.
+    """
+    assert mu_0._is_scalar
+    assert T0._is_scalar
+    assert T1._is_scalar
+
+    cdef GenerationOptions options = _generation_options(
+        method, queue, sampling, threads, kernel, kernel_tau, magnitudes,
+        corner_magnitude, magnitude_table, magnitude_weights, background,
+        background_times, background_factors, kernel_rtol, kernel_horizon,
+        initialization, init_window, init_tolerance, retire_tolerance,
+        aggregate_age, aggregate_width, engine, rng_thread
+    )
+    cdef GenerationInfo info
+
+    cdef CatalogArena* catalog = new CatalogArena(chunk_size)
+    cdef Quantity Mi, ti
+    cdef size_t k, n, seed_
+    bit_generator = _bit_generator(seed)
+    lock = nullcontext() if bit_generator is None else bit_generator.lock
+    try:
+        with lock:
+            if bit_generator is None:
+                seed_ = seed
+            else:
+                seed_ = _attach_bit_generator(bit_generator, options)
+            _generate_catalog_M_t_window_nogil(
+                mu_0.wrapper(),
+                Mmin,
+                Mmax,
+                beta,
+                alpha,
+                p,
+                c.wrapper(),
+                offspring_fraction,
+                T0.wrapper(),
+                T1.wrapper(),
+                seed_,
+                options,
+                info,
+                catalog[0]
+            )
+
+        if chunks:
+            result = []
+            for k in range(catalog.n_chunks()):
+                n = catalog.chunk_length(k)
+                result.append((
+                    Quantity(_release_chunk(catalog.release_M(k), n), '1'),
+                    Quantity(_release_chunk(catalog.release_t(k), n), 's')
+                ))
+        else:
+            Mi = Quantity.zeros(catalog.size(), '1')
+            ti = Quantity.zeros(catalog.size(), 's')
+            catalog.copy_to(Mi.wrapper(), ti.wrapper())
+            result = (Mi, ti)
+    finally:
+        del catalog
+
+    if return_info:
+        return result, _info_dict(info, False)
+    return result
+
+
+def generate_ensemble_M_t_window(
+        seeds,
+        Quantity T0,
+        Quantity T1,
+        Quantity mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        double alpha,
+        double p,
+        Quantity c,
+        double offspring_fraction,
+        bint ragged = False,
+        burn_in_seed = None,
+        size_t chunk_size = 4096,
+        str method = "sequential",
+        str queue = "radix",
+        str sampling = "clock",
+        unsigned int threads = 0,
+        str kernel = "omori",
+        double kernel_tau = 1e6,
+        str magnitudes = "gutenberg_richter",
+        double corner_magnitude = float('nan'),
+        magnitude_table = None,
+        magnitude_weights = None,
+        str background = "constant",
+        Quantity background_times = None,
+        background_factors = None,
+        double kernel_rtol = 1e-3,
+        double kernel_horizon = 1e8,
+        str initialization = "empty",
+        Quantity init_window = None,
+        double init_tolerance = 1e-6,
+        double retire_tolerance = 0.0,
+        double aggregate_age = 0.0,
+        double aggregate_width = 0.1,
+        str engine = "mt19937_64",
+        bint rng_thread = False,
+        bint return_info = False
+    ):
+    """
+    Generate an ensemble of independent catalogs within the time window
+    [T0, T1), one for each of the `seeds`.
+
+    Member k is the catalog that `generate_catalog_M_t_window` generates
+    with seed seeds[k]. The members are generated concurrently on
+    `threads` threads (0: all cores), each member on a single thread.
+
+    If `ragged` is False, the catalogs are returned concatenated in
+    offset-indexed (CSR) form (Mi, ti, offsets), where member k occupies
+    Mi[offsets[k]:offsets[k+1]] and ti[offsets[k]:offsets[k+1]].
+    Otherwise, a list of (Mi, ti) pairs is returned, one per member.
+
+    If `burn_in_seed` is given, the burn-in [0, T0) is generated only
+    once with this seed, and all members continue from its state with
+    their own seeds. The members are then independent only given this
+    common history. This requires the 'sequential' method.
+
+    With `return_info`, the diagnostics cover all members (and the
+    common burn-in): the counts are summed, and the peak numbers and
+    kernel diagnostics are the maxima over the members.
+
+    The remaining keyword arguments are those of `generate_catalog_M_t`.
+    """
+    assert mu_0._is_scalar
+    assert T0._is_scalar
+    assert T1._is_scalar
+
+    cdef vector[size_t] seed_vec = [int(s) for s in seeds]
+
+    cdef GenerationOptions options = _generation_options(
+        method, queue, sampling, threads, kernel, kernel_tau, magnitudes,
+        corner_magnitude, magnitude_table, magnitude_weights, background,
+        background_times, background_factors, kernel_rtol, kernel_horizon,
+        initialization, init_window, init_tolerance, retire_tolerance,
+        aggregate_age, aggregate_width, engine, rng_thread
+    )
+    cdef GenerationInfo info
+
+    cdef CatalogEnsemble* ensemble = new CatalogEnsemble(
+        seed_vec.size(), chunk_size
+    )
+    cdef Quantity Mi, ti
+    cdef size_t k
+    try:
+        if burn_in_seed is None:
+            _generate_ensemble_M_t_window_nogil(
+                mu_0.wrapper(),
+                Mmin,
+                Mmax,
+                beta,
+                alpha,
+                p,
+                c.wrapper(),
+                offspring_fraction,
+                T0.wrapper(),
+                T1.wrapper(),
+                seed_vec,
+                options,
+                info,
+                ensemble[0]
+            )
+        else:
+            _generate_forked_ensemble_M_t_window_nogil(
+                mu_0.wrapper(),
+                Mmin,
+                Mmax,
+                beta,
+                alpha,
+                p,
+                c.wrapper(),
+                offspring_fraction,
+                T0.wrapper(),
+                T1.wrapper(),
+                int(burn_in_seed),
+                seed_vec,
+                options,
+                info,
+                ensemble[0]
+            )
+
+        if ragged:
+            result = []
+            for k in range(ensemble.n_members()):
+                Mi = Quantity.zeros(ensemble.member(k).size(), '1')
+                ti = Quantity.zeros(ensemble.member(k).size(), 's')
+                ensemble.member(k).copy_to(Mi.wrapper(), ti.wrapper())
+                result.append((Mi, ti))
+        else:
+            Mi = Quantity.zeros(ensemble.size(), '1')
+            ti = Quantity.zeros(ensemble.size(), 's')
+            ensemble.copy_to(Mi.wrapper(), ti.wrapper())
+            offsets = np.array(ensemble.offsets(), dtype=np.uint64)
+            result = (Mi, ti, offsets)
+    finally:
+        del ensemble
+
+    if return_info:
+        return result, _info_dict(info, False)
+    return result
+
+
+def generate_sweep_M_t(
+        size_t N,
+        Quantity mu_0,
+        double Mmin,
+        double Mmax,
+        double beta,
+        alpha,
+        p,
+        Quantity c,
+        offspring_fraction,
+        size_t N_skip = 0,
+        size_t seed = 198372,
+        str method = "sequential",
+        str queue = "radix",
+        str sampling = "clock",
+        unsigned int threads = 0,
+        str kernel = "omori",
+        double kernel_tau = 1e6,
+        str magnitudes = "gutenberg_richter",
+        double corner_magnitude = float('nan'),
+        magnitude_table = None,
+        magnitude_weights = None,
+        str background = "constant",
+        Quantity background_times = None,
+        background_factors = None,
+        double kernel_rtol = 1e-3,
+        double kernel_horizon = 1e8,
+        str initialization = "empty",
+        Quantity init_window = None,
+        double init_tolerance = 1e-6,
+        double retire_tolerance = 0.0,
+        double aggregate_age = 0.0,
+        double aggregate_width = 0.1,
+        str engine = "mt19937_64",
+        bint rng_thread = False,
+        bint return_info = False
+    ):
+    """
+    Generate catalogs of N events over a grid of the parameters `alpha`,
+    `p`, `c`, and `offspring_fraction`.
+
+    The four parameters are broadcast against each other following the
+    NumPy rules, where `c` is a scalar or one-dimensional Quantity. All
+    grid points are validated before any catalog is generated. The
+    grid points are then generated concurrently on `threads` threads
+    (0: all cores) with the same `seed`, that is, with common random
+    numbers.
+
+    Returns the magnitudes Mi and times ti of shape S + (N,), where S is
+    the broadcast shape of the parameters. With `return_info`, the
+    diagnostics cover all grid points as for
+    `generate_ensemble_M_t_window`.
+
+    The remaining keyword arguments are those of `generate_catalog_M_t`.
+    """
+    assert mu_0._is_scalar
+
+    c_s = np.asarray(to_seconds(c.wrapper()))
+    if c._is_scalar:
+        c_s = c_s.reshape(())
+    alpha_b, p_b, c_b, frac_b = np.broadcast_arrays(
+        np.asarray(alpha, dtype=float),
+        np.asarray(p, dtype=float),
+        c_s,
+        np.asarray(offspring_fraction, dtype=float)
+    )
+    shape = alpha_b.shape
+    cdef vector[double] alpha_vec = alpha_b.ravel()
+    cdef vector[double] p_vec = p_b.ravel()
+    cdef vector[double] frac_vec = frac_b.ravel()
+    cdef Quantity c_grid = Quantity(np.ascontiguousarray(c_b.ravel()), 's')
+
+    cdef GenerationOptions options = _generation_options(
+        method, queue, sampling, threads, kernel, kernel_tau, magnitudes,
+        corner_magnitude, magnitude_table, magnitude_weights, background,
+        background_times, background_factors, kernel_rtol, kernel_horizon,
+        initialization, init_window, init_tolerance, retire_tolerance,
+        aggregate_age, aggregate_width, engine, rng_thread
+    )
+    cdef GenerationInfo info
+
+    cdef Quantity Mi = Quantity(np.zeros(shape + (N,)), '1')
+    cdef Quantity ti = Quantity(np.zeros(shape + (N,)), 's')
+
+    _generate_sweep_M_t_nogil(
         mu_0.wrapper(),
         Mmin,
         Mmax,
         beta,
-        alpha,
-        p,
-        c.wrapper(),
-        offspring_fraction,
+        alpha_vec,
+        p_vec,
+        c_grid.wrapper(),
+        frac_vec,
         N_skip,
         seed,
+        options,
+        info,
         Mi.wrapper(),
         ti.wrapper()
     )
 
-    return Mi, ti
\ No newline at end of file
+    if return_info:
+        return Mi, ti, _info_dict(info, False)
+    return Mi, ti